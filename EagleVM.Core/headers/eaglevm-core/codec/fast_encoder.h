@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+
+#include "eaglevm-core/codec/zydis_defs.h"
+
+namespace eagle::codec
+{
+    /**
+     * encodes the small vocabulary handlers and transitions are built from by writing the bytes directly
+     * mov, lea, add, sub, or, and, xor, shl, shr, push, pop, jmp, jcc, movq, pextrq, pinsrq, pushfq and popfq
+     * over registers, immediates and base + index * scale + displacement memory
+     *
+     * anything outside of that, or any form where the choice of encoding is not obvious, is left to zydis
+     *
+     * @param request request in the form ZydisEncoderEncodeInstructionAbsolute takes, relative targets are absolute
+     * @param address runtime address of the instruction
+     * @param buffer room for ZYDIS_MAX_INSTRUCTION_LENGTH bytes
+     * @return length of the encoded instruction, 0 if the request has to go through zydis
+     */
+    uint8_t fast_encode(const enc::req& request, uint64_t address, uint8_t* buffer);
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <ranges>
 #include <deque>
+#include <span>
 
 #include "zydis_defs.h"
 #include "zydis_enum.h"
@@ -8,6 +9,8 @@
 
 #include "eaglevm-core/compiler/code_label.h"
 #include "eaglevm-core/util/assert.h"
+#include "eaglevm-core/util/inline_vector.h"
+#include "eaglevm-core/util/region_arena.h"
 
 namespace eagle::codec::encoder
 {
@@ -91,13 +94,16 @@ namespace eagle::codec::encoder
         bool negative;
     };
 
+    using operand_v = std::variant<mem_op, reg_op, imm_op, imm_label_operand>;
+
     class inst_req
     {
     public:
+        // nothing the machines emit takes more, operands are kept inline so an instruction never allocates
+        static constexpr size_t max_operands = 4;
+
         explicit inst_req(const mnemonic mnemonic): mnemonic(mnemonic)
         {
-            static uint32_t current_uuid = 0;
-            uuid = current_uuid++;
         }
 
         std::vector<asmb::code_label_ptr> get_dependents() const
@@ -180,11 +186,10 @@ namespace eagle::codec::encoder
             return req;
         }
 
-        uint32_t uuid;
         mnemonic mnemonic;
 
-        std::vector<std::variant<mem_op, reg_op, imm_op, imm_label_operand>> operands;
-        uint64_t prefixes;
+        util::inline_vector<operand_v, max_operands> operands;
+        uint64_t prefixes = 0;
 
     private:
         static void encode_op(enc::req& req, const mem_op& mem, uint64_t rva)
@@ -249,15 +254,24 @@ namespace eagle::codec::encoder
 
     using inst_req_label_v = std::variant<inst_req, asmb::code_label_ptr>;
 
+    using inst_list = std::vector<inst_req_label_v, util::arena_allocator<inst_req_label_v>>;
+
     class encode_builder
     {
     public:
+        encode_builder() = default;
+
+        explicit encode_builder(const util::region_arena_ptr& arena)
+            : instruction_list(util::arena_allocator<inst_req_label_v>(arena))
+        {
+        }
+
         template <typename... Args>
         encode_builder& make(const mnemonic mnemonic, Args&&... args)
         {
             inst_req instruction(mnemonic);
 
-            auto make_variant = [](auto&& arg) -> std::variant<mem_op, reg_op, imm_op, imm_label_operand>
+            auto make_variant = [](auto&& arg) -> operand_v
             {
                 using ArgType = std::decay_t<decltype(arg)>;
                 if constexpr (std::is_same_v<ArgType, mem_op>)
@@ -272,7 +286,7 @@ namespace eagle::codec::encoder
 
             (instruction.operands.push_back(make_variant(std::forward<Args>(args))), ...);
 
-            instruction_list.push_back(instruction);
+            instruction_list.push_back(std::move(instruction));
             return *this;
         }
 
@@ -284,6 +298,13 @@ namespace eagle::codec::encoder
 
         encode_builder& transfer_from(encode_builder& from)
         {
+            // an empty builder can take over the whole list if both draw from the same memory
+            if (instruction_list.empty() && instruction_list.get_allocator() == from.instruction_list.get_allocator())
+            {
+                instruction_list = from.take_instructions();
+                return *this;
+            }
+
             instruction_list.insert(instruction_list.end(),
                 std::make_move_iterator(from.instruction_list.begin()),
                 std::make_move_iterator(from.instruction_list.end()));
@@ -292,7 +313,32 @@ namespace eagle::codec::encoder
             return *this;
         }
 
-        std::vector<inst_req_label_v> instruction_list;
+        /**
+         * splices a copy of instructions onto the end of this builder, for bodies that are shared and can't be moved from
+         */
+        encode_builder& append_range(const std::span<const inst_req_label_v> instructions)
+        {
+            instruction_list.insert(instruction_list.end(), instructions.begin(), instructions.end());
+            return *this;
+        }
+
+        /**
+         * @return every instruction and label in emission order, valid until the builder is modified
+         */
+        [[nodiscard]] std::span<const inst_req_label_v> get_instructions() const
+        {
+            return instruction_list;
+        }
+
+        /**
+         * moves the instruction list out for final consumption, the builder is left empty
+         */
+        [[nodiscard]] inst_list take_instructions()
+        {
+            return std::exchange(instruction_list, inst_list(instruction_list.get_allocator()));
+        }
+
+        inst_list instruction_list;
     };
 
     using encode_builder_ptr = std::shared_ptr<encode_builder>;
@@ -59,6 +59,12 @@ namespace eagle::codec
     std::vector<uint8_t> compile(enc::req& request);
     std::vector<uint8_t> compile_absolute(enc::req& request, uint32_t address);
 
+    /**
+     * encodes straight into buffer, which has to have room for ZYDIS_MAX_INSTRUCTION_LENGTH bytes
+     * @return length of the encoded instruction
+     */
+    uint8_t compile_absolute(enc::req& request, uint32_t address, uint8_t* buffer);
+
     std::vector<uint8_t> compile_queue(std::vector<enc::req>& queue);
     std::vector<uint8_t> compile_queue_absolute(std::vector<enc::req>& queue);
 
@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -25,11 +26,9 @@ namespace eagle::asmb
         void bind_start(const code_label_ptr& code_label);
         void add(codec::encoder::inst_req inst);
 
-        [[nodiscard]] std::vector<codec::encoder::inst_req_label_v> get_instructions() const;
-
     private:
         uint32_t uid;
-        static uint32_t current_uid;
+        static std::atomic_uint32_t current_uid;
 
         std::string name;
         bool is_named;
@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <memory>
 #include <string>
 
@@ -11,10 +12,19 @@ namespace eagle::asmb
     public:
         code_label();
         code_label(const std::string& label_name, bool generate_comments);
+        code_label(uint64_t name_id, bool generate_comments);
 
+        /**
+         * labels are allocated from the current thread's region arena when there is one
+         */
         static code_label_ptr create();
         static code_label_ptr create(const std::string& label_name, bool generate_comments = true);
 
+        /**
+         * numbered label, the name is only turned into a string the first time it is asked for
+         */
+        static code_label_ptr create(uint64_t name_id, bool generate_comments = true);
+
         std::string get_name();
         uint32_t get_uuid();
         void set_name(const std::string& new_name);
@@ -29,7 +39,11 @@ namespace eagle::asmb
 
         std::string name;
         bool is_named;
-        
-        uint64_t relative_address;
+
+        uint64_t name_id;
+        bool has_name_id;
+
+        // containers are compiled in parallel and may read a label while its own container places it
+        std::atomic_uint64_t relative_address;
     };
 }
@@ -1,8 +1,15 @@
 #pragma once
 #include "eaglevm-core/compiler/code_container.h"
+#include "eaglevm-core/util/thread_pool.h"
 
 namespace eagle::asmb
 {
+    struct encode_cache_stats
+    {
+        uint64_t hits;
+        uint64_t misses;
+    };
+
     class code_container;
     class section_manager
     {
@@ -14,14 +21,50 @@ namespace eagle::asmb
         void add_code_container(const std::vector<code_container_ptr>& code);
 
         codec::encoded_vec compile_section(uint32_t base);
+
+        /**
+         * compiles every container on the pool with only its own labels resolved, then links the containers
+         * on the calling thread which patches the references that cross containers
+         */
+        codec::encoded_vec compile_section(uint32_t base, util::thread_pool& pool);
+
         [[nodiscard]] std::vector<std::string> generate_comments(const std::string& output) const;
 
         void shuffle_containers();
 
+        /**
+         * when enabled every label relative jmp/jcc starts out as rel8 and is only widened to rel32 once its
+         * displacement stops fitting, layout iterates until no branch has to be widened
+         */
+        void set_branch_relaxation(bool relax);
+
+        /**
+         * @return bytes saved by branch relaxation during the last compile_section
+         */
+        [[nodiscard]] uint32_t get_relaxed_bytes() const;
+
+        /**
+         * @return lookups into the encoding cache over every compile_section of this manager
+         */
+        [[nodiscard]] encode_cache_stats get_cache_stats() const;
+
     private:
+        class encoding_cache;
+        class section_layout;
+
+        std::shared_ptr<encoding_cache> cache;
+
         std::vector<code_container_ptr> section_code_containers;
         bool shuffle_functions = false;
 
+        bool relax_branches = false;
+        uint32_t relaxed_bytes = 0;
+
+        [[nodiscard]] section_layout compile_container(const code_container_ptr& code_container) const;
+        codec::encoded_vec link_section(std::vector<section_layout>& layouts, uint32_t base);
+
+        static bool is_relaxable_branch(const codec::encoder::inst_req& inst);
+        static bool attempt_mov_narrow(codec::enc::req& request);
         static void attempt_instruction_fix(codec::enc::req& request);
     };
 }
\ No newline at end of file
@@ -1,7 +1,8 @@
 #pragma once
-#include <set>
-#include <unordered_set>
+#include <span>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "eaglevm-core/disassembler/dasm.h"
 #include "eaglevm-core/disassembler/analysis/models/info.h"
@@ -13,21 +14,66 @@ namespace eagle::dasm::analysis
     class liveness
     {
     public:
-        std::unordered_map<basic_block_ptr, std::pair<liveness_info, liveness_info>> live;
-
         explicit liveness(segment_dasm_ptr segment);
 
-        void analyze_cross_liveness(const basic_block_ptr& exit_block);
-        std::vector<std::pair<liveness_info, liveness_info>> analyze_block(const basic_block_ptr& block);
-        std::pair<liveness_info, liveness_info> analyze_block_at(const basic_block_ptr& block, size_t idx);
+        void analyze_cross_liveness();
+
+        /// @return pair [in, out] liveness for every instruction of the block. computed on first request and cached
+        /// until the block or its OUT set changes
+        std::span<const std::pair<liveness_info, liveness_info>> analyze_block(const basic_block_ptr& block);
+        const std::pair<liveness_info, liveness_info>& analyze_block_at(const basic_block_ptr& block, size_t idx);
 
         void compute_blocks_use_def();
+
+        /// @brief recomputes the use/def sets of a block whose instructions were modified and solves the cross block liveness
+        /// again from that block. spans handed out by analyze_block before this call, for any block, may be dangling
+        /// afterwards and have to be fetched again
+        void invalidate_block(const basic_block_ptr& block);
         static liveness_info compute_inst_flags(const codec::dec::inst_info& inst_info);
 
+        /// @return true if the block belongs to the analyzed segment
+        [[nodiscard]] bool contains(const basic_block_ptr& block) const;
+
+        /// @return pair [in, out] liveness of the block, filled by analyze_cross_liveness
+        [[nodiscard]] const std::pair<liveness_info, liveness_info>& get_live(const basic_block_ptr& block) const;
+
     private:
         segment_dasm_ptr segment;
-        std::unordered_map<basic_block_ptr, std::pair<liveness_info, liveness_info>> block_use_def;
 
-        static void compute_inst_use_def(codec::dec::inst_info inst_info, liveness_info& use, liveness_info& def);
+        // blocks are numbered by their position in segment->get_blocks() so the solver never has to hash a block
+        std::unordered_map<basic_block_ptr, uint32_t> block_index;
+        std::vector<std::vector<uint32_t>> successors;
+        std::vector<std::vector<uint32_t>> predecessors;
+
+        // blocks that return or branch somewhere outside of the segment
+        std::vector<bool> leaves_segment;
+
+        // postorder of the cfg, a backwards problem converges fastest when visited in this order
+        std::vector<uint32_t> postorder;
+
+        std::vector<std::pair<liveness_info, liveness_info>> block_live;
+        std::vector<std::pair<liveness_info, liveness_info>> block_use_def;
+
+        struct inst_slot
+        {
+            uint32_t offset;
+            uint32_t count;
+            bool live_valid;
+        };
+
+        // per instruction data of every block is stored flat, a block owns [offset, offset + count)
+        std::vector<inst_slot> inst_slots;
+        std::vector<std::pair<liveness_info, liveness_info>> inst_use_def;
+        std::vector<std::pair<liveness_info, liveness_info>> inst_live;
+
+        void compute_block_use_def(uint32_t idx);
+
+        /// @brief runs the worklist until no block IN/OUT changes, starting from the given blocks
+        void solve(const std::vector<uint32_t>& initial);
+
+        void build_cfg();
+        [[nodiscard]] uint32_t get_index(const basic_block_ptr& block) const;
+
+        static void compute_inst_use_def(const codec::dec::inst_info& inst_info, liveness_info& use, liveness_info& def);
     };
 }
@@ -1,105 +1,210 @@
 #pragma once
-#include "eaglevm-core/disassembler/analysis/models/container.h"
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LIVENESS_SSE2
+#endif
+
+#include "eaglevm-core/codec/zydis_helper.h"
 #include "eaglevm-core/util/assert.h"
 
 namespace eagle::dasm::analysis
 {
-    using reg64_set = reg_set_container<64, 16, ZYDIS_REGISTER_RAX>;
-    using reg512_set = reg_set_container<512, 16, ZYDIS_REGISTER_ZMM0>;
-    using eflags_set = reg_set_container<32 * 8, 1>;
-
+    /*
+     * liveness_info is a packed 256 bit set, every lattice operation is a single vector operation
+     *
+     * word 0-1: gpr bytes, register n owns bits [n * 8, n * 8 + 8), one bit per byte of the 64 bit register
+     * word 2: vector lanes, register n owns bits [n * 4, n * 4 + 4), one bit per 128 bit lane of the 512 bit register
+     * word 3: rflags, one bit per rflags bit
+     */
     class liveness_info
     {
     public:
+        /*
+         * @return every gpr byte, vector lane and rflags bit
+         */
+        static liveness_info all()
+        {
+            liveness_info info;
+            info.words[0] = UINT64_MAX;
+            info.words[1] = UINT64_MAX;
+            info.words[vector_word] = UINT64_MAX;
+            info.words[flags_word] = UINT64_MAX;
+
+            return info;
+        }
+
         bool insert_register(const codec::reg reg)
         {
             const codec::reg largest_encoding = get_largest_enclosing(reg);
             const codec::reg_class largest_class = get_reg_class(largest_encoding);
 
-            bool ret = false;
+            const uint64_t previous[word_count] = { words[0], words[1], words[2], words[3] };
             if (largest_class == ZYDIS_REGCLASS_ZMM)
-                ret = r512.insert(reg);
+            {
+                const auto register_index = static_cast<uint16_t>(get_bit_version(reg, codec::bit_512)) - ZYDIS_REGISTER_ZMM0;
+                const auto lane_count = static_cast<uint16_t>(get_reg_size(reg)) / 128;
+
+                words[vector_word] |= ((1ull << lane_count) - 1) << register_index * 4;
+            }
             else if (largest_class == ZYDIS_REGCLASS_GPR64)
-                ret = r64.insert(reg);
-            else if (largest_class == ZYDIS_REGISTER_RFLAGS)
-                ret = flags.insert(reg);
+            {
+                const auto register_index = static_cast<uint16_t>(get_bit_version(reg, codec::bit_64)) - ZYDIS_REGISTER_RAX;
+
+                auto byte_index = register_index * 8;
+                if (is_upper_8(reg)) byte_index += 1;
+
+                const auto byte_count = static_cast<uint16_t>(get_reg_size(reg)) / 8;
+                const uint64_t byte_mask = (1ull << byte_count) - 1;
+
+                words[byte_index / 64] |= byte_mask << byte_index % 64;
+            }
+            else if (largest_class == ZYDIS_REGCLASS_FLAGS)
+            {
+                const auto bit_count = static_cast<uint16_t>(get_reg_size(reg));
+                words[flags_word] |= bit_count == 64 ? UINT64_MAX : (1ull << bit_count) - 1;
+            }
             else
             VM_ASSERT("unknown regclass found");
 
-            return ret;
+            for (int i = 0; i < word_count; i++)
+                if (previous[i] != words[i])
+                    return true;
+
+            return false;
         }
 
         void insert_flags(const uint64_t data)
         {
-            for (int i = 0; i < 64; i++)
-                if (data >> i & 1)
-                    flags.insert_byte(i);
+            words[flags_word] |= data;
         }
 
-        friend liveness_info& operator-(const liveness_info& first, const liveness_info& second)
+        friend liveness_info operator-(const liveness_info& first, const liveness_info& second)
         {
             liveness_info info;
-            info.r64 = first.r64 - second.r64;
-            info.r512 = first.r512 - second.r512;
-            info.flags = first.flags - second.flags;
-
+#if defined(__AVX2__)
+            store(info, _mm256_andnot_si256(load(second), load(first)));
+#elif defined(LIVENESS_SSE2)
+            store(info, _mm_andnot_si128(load(second, 0), load(first, 0)), _mm_andnot_si128(load(second, 1), load(first, 1)));
+#else
+            for (int i = 0; i < word_count; i++)
+                info.words[i] = first.words[i] & ~second.words[i];
+#endif
             return info;
         }
 
-        friend liveness_info& operator|(const liveness_info& first, const liveness_info& second)
+        friend liveness_info operator|(const liveness_info& first, const liveness_info& second)
         {
             liveness_info info;
-            info.r64 = first.r64 | second.r64;
-            info.r512 = first.r512 | second.r512;
-            info.flags = first.flags | second.flags;
-
+#if defined(__AVX2__)
+            store(info, _mm256_or_si256(load(first), load(second)));
+#elif defined(LIVENESS_SSE2)
+            store(info, _mm_or_si128(load(first, 0), load(second, 0)), _mm_or_si128(load(first, 1), load(second, 1)));
+#else
+            for (int i = 0; i < word_count; i++)
+                info.words[i] = first.words[i] | second.words[i];
+#endif
             return info;
         }
 
         friend liveness_info operator&(const liveness_info& first, const liveness_info& second)
         {
             liveness_info info;
-            info.r64 = first.r64 & second.r64;
-            info.r512 = first.r512 & second.r512;
-            info.flags = first.flags & second.flags;
-
+#if defined(__AVX2__)
+            store(info, _mm256_and_si256(load(first), load(second)));
+#elif defined(LIVENESS_SSE2)
+            store(info, _mm_and_si128(load(first, 0), load(second, 0)), _mm_and_si128(load(first, 1), load(second, 1)));
+#else
+            for (int i = 0; i < word_count; i++)
+                info.words[i] = first.words[i] & second.words[i];
+#endif
             return info;
         }
 
-        liveness_info& operator|=(const liveness_info& first)
+        liveness_info& operator|=(const liveness_info& other)
         {
-            this->r64 |= first.r64;
-            this->r512 |= first.r512;
-            this->flags |= first.flags;
+            *this = *this | other;
+            return *this;
+        }
 
+        liveness_info& operator-=(const liveness_info& other)
+        {
+            *this = *this - other;
             return *this;
         }
 
         bool operator==(const liveness_info& other) const
         {
-            return this->r64 == other.r64 && this->r512 == other.r512 && this->flags == other.flags;
+#if defined(__AVX2__)
+            const __m256i diff = _mm256_xor_si256(load(*this), load(other));
+            return _mm256_testz_si256(diff, diff);
+#elif defined(LIVENESS_SSE2)
+            const __m128i diff = _mm_or_si128(
+                _mm_xor_si128(load(*this, 0), load(other, 0)),
+                _mm_xor_si128(load(*this, 1), load(other, 1)));
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) == 0xFFFF;
+#else
+            for (int i = 0; i < word_count; i++)
+                if (words[i] != other.words[i])
+                    return false;
+            return true;
+#endif
         }
 
+        /*
+         * @return one bit per byte of the 64 bit register
+         */
         [[nodiscard]] uint8_t get_gpr64(const codec::reg reg) const
         {
             const auto idx = reg - ZYDIS_REGISTER_RAX;
-            return r64.register_state[idx / 8] >> idx * 8;
+            return words[idx / 8] >> idx % 8 * 8;
         }
 
+        /*
+         * @return one bit per 128 bit lane of the 512 bit register
+         */
         [[nodiscard]] uint8_t get_zmm512(const codec::reg reg) const
         {
             const auto idx = reg - ZYDIS_REGISTER_ZMM0;
-            return r512.register_state[idx / 8] >> idx * 8;
+            return words[vector_word] >> idx * 4 & 0xF;
         }
 
-        uint64_t get_flags() const
+        [[nodiscard]] uint64_t get_flags() const
         {
-            return flags.register_state[0];
+            return words[flags_word];
         }
 
     private:
-        reg64_set r64;
-        reg512_set r512;
-        eflags_set flags;
+        static constexpr int word_count = 4;
+        static constexpr int vector_word = 2;
+        static constexpr int flags_word = 3;
+
+        alignas(32) uint64_t words[word_count] = { };
+
+#if defined(__AVX2__)
+        static __m256i load(const liveness_info& info)
+        {
+            return _mm256_load_si256(reinterpret_cast<const __m256i*>(info.words));
+        }
+
+        static void store(liveness_info& info, const __m256i value)
+        {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(info.words), value);
+        }
+#elif defined(LIVENESS_SSE2)
+        static __m128i load(const liveness_info& info, const int half)
+        {
+            return _mm_load_si128(reinterpret_cast<const __m128i*>(info.words) + half);
+        }
+
+        static void store(liveness_info& info, const __m128i low, const __m128i high)
+        {
+            _mm_store_si128(reinterpret_cast<__m128i*>(info.words), low);
+            _mm_store_si128(reinterpret_cast<__m128i*>(info.words) + 1, high);
+        }
+#endif
     };
 }
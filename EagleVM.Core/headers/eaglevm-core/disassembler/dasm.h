@@ -1,4 +1,6 @@
 #pragma once
+#include <deque>
+#include <map>
 #include <queue>
 #include <tuple>
 
@@ -102,6 +104,37 @@ namespace eagle::dasm
         
         std::vector<basic_block_ptr> blocks;
 
+        /// @brief interval index of the explored blocks keyed by their starting rva.
+        /// blocks never overlap so a containment query is a single upper_bound
+        std::map<uint64_t, basic_block_ptr> block_index;
+
+        /// @brief finds the block in the index whose range [start_rva, end_rva_inc) contains the rva
+        /// @return the containing block, nullptr if there is none
+        static basic_block_ptr find_containing(const std::map<uint64_t, basic_block_ptr>& index, uint64_t rva);
+
+        struct cached_inst
+        {
+            codec::dec::inst_info decode;
+
+            // only filled for ret, jmp and jcc, straight line instructions have their fall through computed on request
+            std::vector<branch_info_t> branches;
+        };
+
+        /// @brief instructions decoded so far, a deque so references stay valid as it grows
+        std::deque<cached_inst> decode_cache;
+
+        /// @brief maps a buffer offset to its entry in decode_cache, UINT32_MAX if it has not been decoded
+        std::vector<uint32_t> decode_index;
+
+        /// @brief decodes the instruction at the rva the first time it is requested, every other request is served from the cache
+        /// @return decoded instruction and its resolved branches
+        /// @ensures out.decode = full decode of the instruction at rva
+        const cached_inst& get_cached(uint64_t rva);
+
+        /// @brief computes the branches of an already decoded ret, jmp or jcc
+        /// @return branching information about the instruction
+        static std::vector<branch_info_t> resolve_branches(const codec::dec::inst_info& inst, uint64_t rva);
+
         /// @brief decodes an instruction at the specified rva.
         /// @return pair [decoded instruction info, size of instruction]
         // @ensures out = decoded instruction information and size of the instruction
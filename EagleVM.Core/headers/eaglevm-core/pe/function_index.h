@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <linuxpe>
+
+#include "eaglevm-core/disassembler/dasm.h"
+#include "eaglevm-core/util/thread_pool.h"
+
+namespace eagle::pe
+{
+    struct function_range
+    {
+        uint32_t rva_begin;
+        uint32_t rva_end;
+    };
+
+    /**
+     * whole image index of function boundaries built once from the exception directory (.pdata)
+     * the image is only ever read so one instance can be shared by any number of workers
+     */
+    class function_index
+    {
+    public:
+        explicit function_index(win::image_x64_t* image);
+
+        /**
+         * @param rva any rva inside of a function
+         * @return the function whose range [rva_begin, rva_end) contains rva, nullptr if none does
+         */
+        [[nodiscard]] const function_range* find_function(uint32_t rva) const;
+
+        /**
+         * @param rva entry point of a function
+         * @return the function beginning exactly at rva, nullptr if none does
+         */
+        [[nodiscard]] const function_range* find_entry(uint32_t rva) const;
+
+        /**
+         * @return every indexed function sorted by rva_begin
+         */
+        [[nodiscard]] const std::vector<function_range>& get_functions() const;
+
+        /**
+         * runs explore_blocks for every range in parallel, each segment reads straight from the shared image mapping
+         * @param ranges code ranges to explore, control flow begins at rva_begin
+         * @param pool pool the exploration jobs are submitted to
+         * @return explored segments in the same order as ranges
+         */
+        [[nodiscard]] std::vector<dasm::segment_dasm_ptr> explore(const std::vector<function_range>& ranges, util::thread_pool& pool) const;
+
+    private:
+        win::image_x64_t* image;
+        std::vector<function_range> functions;
+    };
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "eaglevm-core/util/assert.h"
+
+namespace eagle::util
+{
+    /**
+     * vector with a fixed capacity that keeps its elements inline, it never allocates
+     * meant for small bounded lists that are created very often, such as instruction operands
+     */
+    template <typename T, size_t N>
+    class inline_vector
+    {
+    public:
+        inline_vector() = default;
+
+        inline_vector(const inline_vector& other)
+        {
+            for (const T& item : other)
+                emplace_back(item);
+        }
+
+        inline_vector(inline_vector&& other) noexcept
+        {
+            for (T& item : other)
+                emplace_back(std::move(item));
+        }
+
+        ~inline_vector()
+        {
+            clear();
+        }
+
+        inline_vector& operator=(const inline_vector& other)
+        {
+            if (this != &other)
+            {
+                clear();
+                for (const T& item : other)
+                    emplace_back(item);
+            }
+
+            return *this;
+        }
+
+        inline_vector& operator=(inline_vector&& other) noexcept
+        {
+            if (this != &other)
+            {
+                clear();
+                for (T& item : other)
+                    emplace_back(std::move(item));
+            }
+
+            return *this;
+        }
+
+        template <typename... Args>
+        T& emplace_back(Args&&... args)
+        {
+            VM_ASSERT(count < N, "inline_vector capacity exceeded");
+
+            T* item = std::construct_at(data() + count, std::forward<Args>(args)...);
+            count++;
+
+            return *item;
+        }
+
+        void push_back(const T& item) { emplace_back(item); }
+        void push_back(T&& item) { emplace_back(std::move(item)); }
+
+        void clear()
+        {
+            std::destroy_n(data(), count);
+            count = 0;
+        }
+
+        [[nodiscard]] size_t size() const { return count; }
+        [[nodiscard]] bool empty() const { return count == 0; }
+        static constexpr size_t capacity() { return N; }
+
+        T* data() { return std::launder(reinterpret_cast<T*>(storage)); }
+        const T* data() const { return std::launder(reinterpret_cast<const T*>(storage)); }
+
+        T& operator[](const size_t index) { return data()[index]; }
+        const T& operator[](const size_t index) const { return data()[index]; }
+
+        T* begin() { return data(); }
+        T* end() { return data() + count; }
+        const T* begin() const { return data(); }
+        const T* end() const { return data() + count; }
+
+    private:
+        alignas(T) std::byte storage[sizeof(T) * N];
+        size_t count = 0;
+    };
+}
@@ -1,22 +1,80 @@
 #pragma once
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <random>
+#include <vector>
 #include "eaglevm-core/util/assert.h"
 
 namespace eagle::util
 {
+    /**
+     * xoshiro256** engine, satisfies UniformRandomBitGenerator so it can be handed to std::shuffle and friends
+     */
+    class xoshiro256
+    {
+    public:
+        using result_type = uint64_t;
+
+        xoshiro256() { seed(0); }
+        explicit xoshiro256(const uint64_t value) { seed(value); }
+
+        void seed(uint64_t value);
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        result_type operator()()
+        {
+            const uint64_t result = rotl(state[1] * 5, 7) * 9;
+            const uint64_t t = state[1] << 17;
+
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+
+            state[2] ^= t;
+            state[3] = rotl(state[3], 45);
+
+            return result;
+        }
+
+    private:
+        std::array<uint64_t, 4> state{ };
+
+        static constexpr uint64_t rotl(const uint64_t x, const int k)
+        {
+            return x << k | x >> (64 - k);
+        }
+    };
+
     class ran_device
     {
     public:
-        std::mt19937 gen{ };
+        xoshiro256 gen{ };
         uint64_t seed;
 
         ran_device();
+        explicit ran_device(uint64_t stream_seed);
+
+        /**
+         * @return the generator installed on the calling thread by a ran_stream, otherwise the master device
+         */
         static ran_device& get();
 
+        /**
+         * derives an independent stream from this device's seed. the result only depends on the seed and
+         * the stream id so forks are reproducible regardless of which thread creates them or when
+         * @param stream_id identifier of the stream, for example a region or vm index
+         */
+        [[nodiscard]] ran_device fork(uint64_t stream_id) const;
+
         uint64_t gen_64();
         uint32_t gen_32();
         uint16_t gen_16();
         uint8_t gen_8();
+        void gen_bytes(uint8_t* out, size_t size);
         uint64_t gen_dist(std::uniform_int_distribution<uint64_t>& distribution);
         bool gen_chance(float chance);
         double gen_dist(std::uniform_real_distribution<>& distribution);
@@ -26,7 +84,7 @@ namespace eagle::util
         {
             VM_ASSERT(!vec.empty(), "cannot get a random element from an empty vector");
 
-            std::uniform_int_distribution<> dist(0, vec.size() - 1);
+            std::uniform_int_distribution<size_t> dist(0, vec.size() - 1);
             return vec[dist(gen)];
         }
 
@@ -34,5 +92,22 @@ namespace eagle::util
         ran_device& operator=(const ran_device&) = delete;
     };
 
+    /**
+     * installs a device as the current thread's generator for the lifetime of the scope
+     * every region, machine and pass that should be reproducible runs inside one of these
+     */
+    class ran_stream
+    {
+    public:
+        explicit ran_stream(ran_device& device);
+        ~ran_stream();
+
+        ran_stream(const ran_stream&) = delete;
+        ran_stream& operator=(const ran_stream&) = delete;
+
+    private:
+        ran_device* previous;
+    };
+
     ran_device& get_ran_device();
 }
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace eagle::util
+{
+    using region_arena_ptr = std::shared_ptr<class region_arena>;
+
+    /**
+     * bump allocator for everything the assembler creates while a region is being virtualized
+     * nothing is freed individually, the whole arena goes away once the last object allocated from it is released
+     *
+     * an arena is not thread safe, it is only ever allocated from by the thread that installed it with an arena_scope
+     */
+    class region_arena
+    {
+    public:
+        explicit region_arena(size_t initial_size = 1 << 16);
+
+        static region_arena_ptr create(size_t initial_size = 1 << 16);
+
+        /**
+         * @return the arena installed on the calling thread by an arena_scope, nullptr if there is none
+         */
+        static region_arena_ptr current();
+
+        void* allocate(size_t size, size_t alignment);
+
+    private:
+        std::pmr::monotonic_buffer_resource buffer;
+    };
+
+    /**
+     * installs an arena as the current thread's arena for the lifetime of the scope
+     */
+    class arena_scope
+    {
+    public:
+        explicit arena_scope(const region_arena_ptr& arena);
+        ~arena_scope();
+
+        arena_scope(const arena_scope&) = delete;
+        arena_scope& operator=(const arena_scope&) = delete;
+
+    private:
+        region_arena_ptr previous;
+    };
+
+    /**
+     * allocator that draws from a region arena, falls back to the heap when constructed without one
+     * every copy holds a reference to the arena, so containers and shared_ptr control blocks keep it alive
+     */
+    template <typename T>
+    class arena_allocator
+    {
+    public:
+        using value_type = T;
+
+        arena_allocator() = default;
+
+        explicit arena_allocator(region_arena_ptr arena)
+            : arena(std::move(arena))
+        {
+        }
+
+        template <typename U>
+        arena_allocator(const arena_allocator<U>& other)
+            : arena(other.get_arena())
+        {
+        }
+
+        T* allocate(const size_t n)
+        {
+            if (arena)
+                return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+
+            return std::allocator<T>{ }.allocate(n);
+        }
+
+        void deallocate(T* ptr, const size_t n)
+        {
+            // arena memory is released all at once with the arena
+            if (!arena)
+                std::allocator<T>{ }.deallocate(ptr, n);
+        }
+
+        [[nodiscard]] const region_arena_ptr& get_arena() const
+        {
+            return arena;
+        }
+
+        template <typename U>
+        bool operator==(const arena_allocator<U>& other) const
+        {
+            return arena == other.get_arena();
+        }
+
+    private:
+        region_arena_ptr arena;
+    };
+}
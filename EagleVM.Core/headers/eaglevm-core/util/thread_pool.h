@@ -0,0 +1,146 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eagle::util
+{
+    /**
+     * small work stealing pool, every worker owns a queue and will steal from the front of
+     * other workers queues once its own queue is empty
+     */
+    class thread_pool
+    {
+    public:
+        explicit thread_pool(size_t worker_count = std::thread::hardware_concurrency())
+        {
+            if (worker_count == 0)
+                worker_count = 1;
+
+            for (size_t i = 0; i < worker_count; i++)
+                queues.push_back(std::make_unique<worker_queue>());
+
+            for (size_t i = 0; i < worker_count; i++)
+                workers.emplace_back([this, i] { worker_loop(i); });
+        }
+
+        ~thread_pool()
+        {
+            {
+                std::lock_guard lock(wake_mutex);
+                stopping = true;
+            }
+
+            wake.notify_all();
+            for (auto& worker : workers)
+                worker.join();
+        }
+
+        template <typename F>
+        auto submit(F&& task) -> std::future<std::invoke_result_t<F>>
+        {
+            using result_t = std::invoke_result_t<F>;
+
+            auto packaged = std::make_shared<std::packaged_task<result_t()>>(std::forward<F>(task));
+            std::future<result_t> result = packaged->get_future();
+
+            // round robin tasks into the worker queues, idle workers steal the rest
+            worker_queue& queue = *queues[next_queue++ % queues.size()];
+            {
+                std::lock_guard lock(queue.mutex);
+                queue.tasks.emplace_back([packaged] { (*packaged)(); });
+            }
+
+            {
+                std::lock_guard lock(wake_mutex);
+                pending++;
+            }
+
+            wake.notify_one();
+            return result;
+        }
+
+        [[nodiscard]] size_t size() const
+        {
+            return workers.size();
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+    private:
+        struct worker_queue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<worker_queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic_size_t next_queue = 0;
+
+        std::mutex wake_mutex;
+        std::condition_variable wake;
+        size_t pending = 0;
+        bool stopping = false;
+
+        bool pop_task(const size_t index, std::function<void()>& task)
+        {
+            // own queue is worked from the back
+            {
+                worker_queue& own = *queues[index];
+                std::lock_guard lock(own.mutex);
+                if (!own.tasks.empty())
+                {
+                    task = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                    return true;
+                }
+            }
+
+            // everyone else is stolen from the front
+            for (size_t i = 1; i < queues.size(); i++)
+            {
+                worker_queue& victim = *queues[(index + i) % queues.size()];
+                std::lock_guard lock(victim.mutex);
+                if (!victim.tasks.empty())
+                {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void worker_loop(const size_t index)
+        {
+            while (true)
+            {
+                {
+                    std::unique_lock lock(wake_mutex);
+                    wake.wait(lock, [this] { return stopping || pending != 0; });
+
+                    if (pending == 0)
+                        return;
+
+                    // reserve a task before leaving the lock so that pending always matches the queues
+                    pending--;
+                }
+
+                std::function<void()> task;
+                while (!pop_task(index, task))
+                    std::this_thread::yield();
+
+                task();
+            }
+        }
+    };
+}
@@ -1,4 +1,7 @@
 #pragma once
+#include <optional>
+
+#include "eaglevm-core/disassembler/analysis/models/info.h"
 #include "eaglevm-core/virtual_machine/ir/commands/base_command.h"
 
 namespace eagle::ir
@@ -6,14 +9,22 @@ namespace eagle::ir
     class cmd_vm_enter : public base_command
     {
     public:
-        explicit cmd_vm_enter()
-            : base_command(command_type::vm_enter)
-        {
-        }
+        /**
+         * @param live registers live coming into the vm, anything left out does not have to be saved
+         */
+        explicit cmd_vm_enter(const std::optional<dasm::analysis::liveness_info>& live = std::nullopt);
+
+        bool is_similar(const std::shared_ptr<base_command>& other) override;
+
+        /**
+         * @return registers live at the transition, nullopt when every register has to be assumed live
+         */
+        const std::optional<dasm::analysis::liveness_info>& get_live() const;
 
         BASE_COMMAND_CLONE(cmd_vm_enter);
 
     private:
+        std::optional<dasm::analysis::liveness_info> live;
     };
 
     SHARED_DEFINE(cmd_vm_enter);
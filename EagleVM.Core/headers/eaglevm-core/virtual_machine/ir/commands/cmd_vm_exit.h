@@ -1,4 +1,7 @@
 #pragma once
+#include <optional>
+
+#include "eaglevm-core/disassembler/analysis/models/info.h"
 #include "eaglevm-core/virtual_machine/ir/commands/base_command.h"
 #include "eaglevm-core/virtual_machine/ir/commands/models/branch_command.h"
 
@@ -7,13 +10,25 @@ namespace eagle::ir
     class cmd_vm_exit : public branch_command, public base_command
     {
     public:
-        explicit cmd_vm_exit(const ir_exit_result& result);
+        /**
+         * @param result where execution continues after leaving the vm
+         * @param live registers live after the exit, anything left out does not have to be restored
+         */
+        explicit cmd_vm_exit(const ir_exit_result& result, const std::optional<dasm::analysis::liveness_info>& live = std::nullopt);
 
         bool is_similar(const std::shared_ptr<base_command>& other) override;
         ir_exit_result get_exit();
         std::string to_string() override;
 
+        /**
+         * @return registers live at the transition, nullopt when every register has to be assumed live
+         */
+        const std::optional<dasm::analysis::liveness_info>& get_live() const;
+
         BASE_COMMAND_CLONE(cmd_vm_exit);
+
+    private:
+        std::optional<dasm::analysis::liveness_info> live;
     };
 
     SHARED_DEFINE(cmd_vm_exit);
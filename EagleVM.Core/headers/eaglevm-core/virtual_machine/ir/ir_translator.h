@@ -6,6 +6,7 @@
 #include "eaglevm-core/disassembler/basic_block.h"
 #include "eaglevm-core/disassembler/analysis/liveness.h"
 #include "eaglevm-core/virtual_machine/ir/block.h"
+#include "eaglevm-core/virtual_machine/ir/settings.h"
 #include "eaglevm-core/virtual_machine/ir/x86/base_handler_gen.h"
 #include "models/ir_branch_info.h"
 
@@ -23,10 +24,20 @@ namespace eagle::ir
     using preopt_vm_id = std::pair<preopt_block_ptr, uint32_t>;
     using flat_block_vmid = std::pair<std::vector<block_ptr>, uint32_t>;
 
+    struct transition_stats
+    {
+        // native edges between blocks of the same vm that became virtual branches
+        uint32_t virtual_edges;
+
+        uint32_t removed_exits;
+        uint32_t removed_enters;
+    };
+
     class ir_translator : public std::enable_shared_from_this<ir_translator>
     {
     public:
-        explicit ir_translator(const dasm::segment_dasm_ptr& seg_dasm, dasm::analysis::liveness* liveness = nullptr);
+        explicit ir_translator(const dasm::segment_dasm_ptr& seg_dasm, dasm::analysis::liveness* liveness = nullptr,
+            const settings_ptr& settings_info = nullptr);
 
         std::vector<preopt_block_ptr> translate();
         std::vector<flat_block_vmid> flatten(
@@ -49,11 +60,20 @@ namespace eagle::ir
          */
         branch_info get_branch_info(uint32_t inst_rva);
 
+        /**
+         * @return vm transitions the last optimize call removed between blocks of the same vm
+         */
+        [[nodiscard]] transition_stats get_transition_stats() const;
+
     private:
         dasm::segment_dasm_ptr dasm;
         dasm::analysis::liveness* dasm_liveness;
         std::unordered_map<dasm::basic_block_ptr, preopt_block_ptr> bb_map;
 
+        settings_ptr settings;
+
+        transition_stats same_vm_stats = { };
+
         void optimize_heads(
             std::unordered_map<preopt_block_ptr, uint32_t>& block_vm_ids,
             std::unordered_map<preopt_block_ptr, block_ptr>& block_tracker,
@@ -73,6 +93,17 @@ namespace eagle::ir
         );
 
         preopt_block_ptr translate_block_split(dasm::basic_block_ptr bb);
+
+        /**
+         * finds short runs of supported instructions between two unsupported ones that are cheaper to leave native
+         * @return per instruction of the block, true if it should be executed natively
+         */
+        std::vector<bool> find_native_runs(const dasm::basic_block_ptr& bb,
+            std::span<const std::pair<dasm::analysis::liveness_info, dasm::analysis::liveness_info>> liveness) const;
+
+        static bool is_ignored(const codec::dec::inst_info& decoded_inst);
+        static codec::mnemonic get_handler_mnemonic(codec::mnemonic mnemonic);
+        static std::optional<uint64_t> get_target_handler(const codec::dec::inst_info& decoded_inst);
         static std::pair<exit_condition, bool> get_exit_condition(codec::mnemonic mnemonic);
         static void handle_block_command(codec::dec::inst_info decoded_inst, const block_ptr& current_block, uint64_t current_rva);
     };
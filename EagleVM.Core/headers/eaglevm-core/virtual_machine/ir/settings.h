@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+
+namespace eagle::ir
+{
+    struct settings
+    {
+        /**
+        * longest run of supported instructions the translator may leave native when it sits between two unsupported
+        * instructions, both unsupported instructions then share a single vm exit and vm enter
+        *
+        * a run is only left native when the exit and enter it saves would carry more registers than the run has
+        * instructions, 0 virtualizes every supported instruction
+        *
+        * recommended value: 2
+        */
+        uint32_t native_run_threshold = 0;
+
+        /**
+        * native edges between blocks of the same vm are turned into virtual branches so control never leaves the vm
+        * between them, turning it off keeps a vm exit and vm enter on every one of those edges
+        */
+        bool optimize_same_vm = true;
+    };
+
+    using settings_ptr = std::shared_ptr<settings>;
+}
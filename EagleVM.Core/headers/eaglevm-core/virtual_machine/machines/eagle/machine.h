@@ -1,4 +1,5 @@
 #pragma once
+#include <map>
 #include <vector>
 #include "eaglevm-core/virtual_machine/machines/base_machine.h"
 #include "eaglevm-core/virtual_machine/machines/register_context.h"
@@ -10,6 +11,28 @@
 
 namespace eagle::virt::eg
 {
+    struct handler_stats
+    {
+        // distinct handlers and the variants generated for them
+        uint32_t handler_keys;
+        uint32_t handler_variants;
+
+        // bodies lowered for handler calls
+        uint32_t call_bodies;
+
+        // handler calls that reused a body lowered for an earlier call
+        uint32_t reused_calls;
+
+        // handler uses that picked an existing variant from the pool instead of generating one
+        uint32_t reused_variants;
+
+        // bodies dropped by create_handlers because another body encodes to the same bytes
+        uint32_t folded_bodies;
+
+        // bodies dropped by create_handlers because nothing lifted by this machine can reach them
+        uint32_t dead_bodies;
+    };
+
     using machine_ptr = std::shared_ptr<class machine>;
     class machine final : public base_machine
     {
@@ -55,9 +78,23 @@ namespace eagle::virt::eg
 
         std::vector<asmb::code_container_ptr> create_handlers() override;
 
+        /**
+         * sizes the stack vm_enter reserves from the deepest the virtual stack gets across the blocks of this machine
+         * the fixed reservation is the floor, anything that moves VSP in a way that cannot be followed keeps it as is
+         *
+         * @param blocks every block this machine is going to lift
+         * @return bytes vm_enter reserves below the entry rsp
+         */
+        uint32_t reserve_stack(const std::vector<ir::block_ptr>& blocks);
+
+        [[nodiscard]] handler_stats get_handler_stats() const;
+
     private:
         settings_ptr settings;
 
+        // qwords vm_enter reserves below the entry rsp for the virtual stack, 0 until reserve_stack sized it
+        int32_t stack_reserve = 0;
+
         register_manager_ptr regs;
         register_context_ptr reg_64_container;
         register_context_ptr reg_128_container;
@@ -66,6 +103,37 @@ namespace eagle::virt::eg
         std::unordered_map<size_t, std::vector<handler_info_pair>> handler_map;
         std::vector<handler_info_pair> misc_handlers;
 
+        // mnemonic, signature kind and signature to the body a handler call was already lowered into
+        std::map<std::vector<uint64_t>, asmb::code_label_ptr> handler_call_labels;
+        uint32_t reused_calls = 0;
+        uint32_t reused_variants = 0;
+        uint32_t folded_handlers = 0;
+        uint32_t dead_handlers = 0;
+
+        // every block container this machine lifted, the roots handlers are kept alive from
+        std::vector<asmb::code_container_ptr> lifted_blocks;
+
+        /**
+         * folds handler bodies that are identical once their own labels are numbered by position, repeated until nothing
+         * folds so callers of folded handlers fold as well
+         * the labels of a folded body are placed next to their counterparts in the body that is kept
+         *
+         * @param handlers every handler body of this machine
+         * @return the bodies that are left
+         */
+        std::vector<asmb::code_container_ptr> fold_handlers(const std::vector<asmb::code_container_ptr>& handlers);
+
+        /**
+         * drops handler bodies that cannot be reached from the lifted blocks through label references
+         * create_handler always calls the body it creates or picks, so every body starts out referenced by the container it
+         * was lowered into. one only becomes unreachable when all of its callers are handler bodies that are unreachable
+         * themselves, every handler a lifted block references is kept
+         *
+         * @param handlers every handler body of this machine
+         * @return the bodies that are reachable
+         */
+        std::vector<asmb::code_container_ptr> sweep_handlers(const std::vector<asmb::code_container_ptr>& handlers);
+
         [[nodiscard]] codec::reg reg_vm_to_register(ir::reg_vm store) const;
         void handle_generic_logic_cmd(codec::mnemonic command, ir::ir_size ir_size, bool preserved, codec::encoder::encode_builder& out,
             const std::function<codec::reg()>& alloc_reg);
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 
 namespace eagle::virt::eg
@@ -15,6 +16,14 @@ namespace eagle::virt::eg
         */
         float chance_to_generate_x86_handler = 0.3;
 
+        /**
+        * upper bound on the number of variants generated for a single handler,
+        * once reached calls pick one of the existing variants instead of rolling for a new one
+        *
+        * 0 leaves the number of variants unbounded
+        */
+        uint32_t max_handler_variants = 4;
+
         bool shuffle_push_order = false;
         bool shuffle_vm_gpr_order = false;
         bool shuffle_vm_xmm_order = false;
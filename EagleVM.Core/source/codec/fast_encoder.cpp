@@ -0,0 +1,763 @@
+#include "eaglevm-core/codec/fast_encoder.h"
+
+#include <optional>
+
+namespace eagle::codec
+{
+    namespace
+    {
+        constexpr uint8_t rex_base = 0x40;
+        constexpr uint8_t rex_w = 0x08;
+        constexpr uint8_t rex_r = 0x04;
+        constexpr uint8_t rex_x = 0x02;
+        constexpr uint8_t rex_b = 0x01;
+
+        constexpr uint8_t operand_size_prefix = 0x66;
+
+        struct gpr
+        {
+            uint8_t id;
+            uint8_t size;
+
+            // spl, bpl, sil and dil only exist with a rex prefix
+            bool needs_rex;
+        };
+
+        std::optional<gpr> get_gpr(const ZydisRegister reg)
+        {
+            if (reg >= ZYDIS_REGISTER_AL && reg <= ZYDIS_REGISTER_BL)
+                return gpr{ static_cast<uint8_t>(reg - ZYDIS_REGISTER_AL), 1, false };
+            if (reg >= ZYDIS_REGISTER_SPL && reg <= ZYDIS_REGISTER_DIL)
+                return gpr{ static_cast<uint8_t>(reg - ZYDIS_REGISTER_SPL + 4), 1, true };
+            if (reg >= ZYDIS_REGISTER_R8B && reg <= ZYDIS_REGISTER_R15B)
+                return gpr{ static_cast<uint8_t>(reg - ZYDIS_REGISTER_R8B + 8), 1, false };
+            if (reg >= ZYDIS_REGISTER_AX && reg <= ZYDIS_REGISTER_R15W)
+                return gpr{ static_cast<uint8_t>(reg - ZYDIS_REGISTER_AX), 2, false };
+            if (reg >= ZYDIS_REGISTER_EAX && reg <= ZYDIS_REGISTER_R15D)
+                return gpr{ static_cast<uint8_t>(reg - ZYDIS_REGISTER_EAX), 4, false };
+            if (reg >= ZYDIS_REGISTER_RAX && reg <= ZYDIS_REGISTER_R15)
+                return gpr{ static_cast<uint8_t>(reg - ZYDIS_REGISTER_RAX), 8, false };
+
+            // ah through bh can't be encoded next to a rex prefix, those are left to zydis
+            return std::nullopt;
+        }
+
+        std::optional<uint8_t> get_xmm(const ZydisRegister reg)
+        {
+            // xmm16 and up need evex
+            if (reg >= ZYDIS_REGISTER_XMM0 && reg <= ZYDIS_REGISTER_XMM15)
+                return static_cast<uint8_t>(reg - ZYDIS_REGISTER_XMM0);
+
+            return std::nullopt;
+        }
+
+        bool fits_signed(const int64_t value, const uint8_t bits)
+        {
+            const int64_t limit = 1ll << (bits - 1);
+            return value >= -limit && value < limit;
+        }
+
+        /*
+         * the modrm.rm side of an instruction, either a register or a memory reference
+         */
+        struct rm_operand
+        {
+            uint8_t mod = 0;
+            uint8_t rm = 0;
+
+            bool has_sib = false;
+            uint8_t sib = 0;
+
+            uint8_t disp_size = 0;
+            int64_t disp = 0;
+
+            // rip relative displacements are absolute until the length of the instruction is known
+            bool rip_relative = false;
+
+            uint8_t rex = 0;
+            bool needs_rex = false;
+        };
+
+        rm_operand rm_register(const uint8_t id, const bool needs_rex = false)
+        {
+            rm_operand operand;
+            operand.mod = 3;
+            operand.rm = id & 7;
+            operand.rex = id >= 8 ? rex_b : 0;
+            operand.needs_rex = needs_rex;
+
+            return operand;
+        }
+
+        std::optional<rm_operand> rm_memory(const enc::op_mem& mem)
+        {
+            rm_operand operand;
+            if (mem.base == ZYDIS_REGISTER_RIP)
+            {
+                if (mem.index != ZYDIS_REGISTER_NONE)
+                    return std::nullopt;
+
+                operand.mod = 0;
+                operand.rm = 5;
+                operand.disp_size = 4;
+                operand.disp = mem.displacement;
+                operand.rip_relative = true;
+
+                return operand;
+            }
+
+            // only 64 bit addressing with a base register, everything else goes through zydis
+            const std::optional<gpr> base = get_gpr(mem.base);
+            if (!base || base->size != 8 || !fits_signed(mem.displacement, 32))
+                return std::nullopt;
+
+            const uint8_t base_id = base->id;
+            operand.rex |= base_id >= 8 ? rex_b : 0;
+
+            if (mem.index != ZYDIS_REGISTER_NONE)
+            {
+                const std::optional<gpr> index = get_gpr(mem.index);
+                if (!index || index->size != 8 || index->id == 4)
+                    return std::nullopt;
+
+                uint8_t scale_bits;
+                switch (mem.scale)
+                {
+                    case 1: scale_bits = 0;
+                        break;
+                    case 2: scale_bits = 1;
+                        break;
+                    case 4: scale_bits = 2;
+                        break;
+                    case 8: scale_bits = 3;
+                        break;
+                    default:
+                        return std::nullopt;
+                }
+
+                operand.rm = 4;
+                operand.has_sib = true;
+                operand.sib = scale_bits << 6 | (index->id & 7) << 3 | (base_id & 7);
+                operand.rex |= index->id >= 8 ? rex_x : 0;
+            }
+            else
+            {
+                if (mem.scale > 1)
+                    return std::nullopt;
+
+                // rsp and r12 can only be a base through a sib byte
+                operand.rm = base_id & 7;
+                if (operand.rm == 4)
+                {
+                    operand.has_sib = true;
+                    operand.sib = 4 << 3 | 4;
+                }
+            }
+
+            // rbp and r13 have no displacement free form
+            if (mem.displacement == 0 && (base_id & 7) != 5)
+                operand.mod = 0;
+            else if (fits_signed(mem.displacement, 8))
+                operand.mod = 1, operand.disp_size = 1;
+            else
+                operand.mod = 2, operand.disp_size = 4;
+
+            operand.disp = mem.displacement;
+            return operand;
+        }
+
+        /*
+         * everything needed to write one legacy encoded instruction
+         * [66] [rex] opcode [modrm [sib] [disp]] [imm]
+         */
+        struct encoding
+        {
+            uint8_t prefix = 0;
+            uint8_t rex = 0;
+            bool needs_rex = false;
+
+            uint8_t opcode[3] = { };
+            uint8_t opcode_length = 0;
+
+            // modrm.reg, either a register id or an opcode extension
+            uint8_t reg = 0;
+            std::optional<rm_operand> rm;
+
+            uint64_t imm = 0;
+            uint8_t imm_size = 0;
+
+            void set_opcode(const uint8_t op)
+            {
+                opcode[0] = op;
+                opcode_length = 1;
+            }
+
+            void set_opcode(const uint8_t* op, const uint8_t length)
+            {
+                for (uint8_t i = 0; i < length; i++)
+                    opcode[i] = op[i];
+
+                opcode_length = length;
+            }
+
+            void set_operand_size(const uint8_t size)
+            {
+                if (size == 2)
+                    prefix = operand_size_prefix;
+                else if (size == 8)
+                    rex |= rex_w;
+            }
+
+            void set_immediate(const uint64_t value, const uint8_t size)
+            {
+                imm = value;
+                imm_size = size;
+            }
+        };
+
+        uint8_t emit(const encoding& enc, const uint64_t address, uint8_t* buffer)
+        {
+            uint8_t length = 0;
+            if (enc.prefix)
+                buffer[length++] = enc.prefix;
+
+            uint8_t rex = enc.rex;
+            bool needs_rex = enc.needs_rex;
+            if (enc.rm)
+            {
+                rex |= enc.rm->rex;
+                rex |= enc.reg >= 8 ? rex_r : 0;
+                needs_rex |= enc.rm->needs_rex;
+            }
+
+            if (rex || needs_rex)
+                buffer[length++] = rex_base | rex;
+
+            for (uint8_t i = 0; i < enc.opcode_length; i++)
+                buffer[length++] = enc.opcode[i];
+
+            uint8_t disp_offset = 0;
+            if (enc.rm)
+            {
+                const rm_operand& rm = *enc.rm;
+                buffer[length++] = rm.mod << 6 | (enc.reg & 7) << 3 | rm.rm;
+
+                if (rm.has_sib)
+                    buffer[length++] = rm.sib;
+
+                disp_offset = length;
+                for (uint8_t i = 0; i < rm.disp_size; i++)
+                    buffer[length++] = static_cast<uint8_t>(rm.disp >> i * 8);
+            }
+
+            for (uint8_t i = 0; i < enc.imm_size; i++)
+                buffer[length++] = static_cast<uint8_t>(enc.imm >> i * 8);
+
+            if (enc.rm && enc.rm->rip_relative)
+            {
+                const int64_t disp = enc.rm->disp - static_cast<int64_t>(address + length);
+                if (!fits_signed(disp, 32))
+                    return 0;
+
+                for (uint8_t i = 0; i < 4; i++)
+                    buffer[disp_offset + i] = static_cast<uint8_t>(disp >> i * 8);
+            }
+
+            return length;
+        }
+
+        /*
+         * reg and memory operands of a request, the size of a memory operand comes from the request
+         */
+        struct operand_info
+        {
+            rm_operand rm;
+            uint8_t size = 0;
+
+            bool is_register = false;
+            uint8_t id = 0;
+        };
+
+        std::optional<operand_info> get_rm_operand(const enc::op& op)
+        {
+            operand_info info;
+            if (op.type == ZYDIS_OPERAND_TYPE_REGISTER)
+            {
+                const std::optional<gpr> reg = get_gpr(op.reg.value);
+                if (!reg)
+                    return std::nullopt;
+
+                info.rm = rm_register(reg->id, reg->needs_rex);
+                info.size = reg->size;
+                info.is_register = true;
+                info.id = reg->id;
+
+                return info;
+            }
+
+            if (op.type == ZYDIS_OPERAND_TYPE_MEMORY)
+            {
+                const std::optional<rm_operand> mem = rm_memory(op.mem);
+                if (!mem)
+                    return std::nullopt;
+
+                info.rm = *mem;
+                info.size = static_cast<uint8_t>(op.mem.size);
+
+                if (op.mem.size != 1 && op.mem.size != 2 && op.mem.size != 4 && op.mem.size != 8)
+                    return std::nullopt;
+
+                return info;
+            }
+
+            return std::nullopt;
+        }
+
+        /*
+         * mov and the classic alu operations share the same layout for their register and memory forms
+         * base + 0: r/m8, r8   base + 1: r/m, r   base + 2: r8, r/m8   base + 3: r, r/m
+         *
+         * the alu operations also have the accumulator forms at base + 4 and base + 5 and live in the 80/81/83 group
+         */
+        struct binary_form
+        {
+            uint8_t base_opcode;
+            uint8_t extension;
+            bool alu;
+        };
+
+        std::optional<binary_form> get_binary_form(const ZydisMnemonic mnemonic)
+        {
+            switch (mnemonic)
+            {
+                case ZYDIS_MNEMONIC_ADD: return binary_form{ 0x00, 0, true };
+                case ZYDIS_MNEMONIC_OR: return binary_form{ 0x08, 1, true };
+                case ZYDIS_MNEMONIC_AND: return binary_form{ 0x20, 4, true };
+                case ZYDIS_MNEMONIC_SUB: return binary_form{ 0x28, 5, true };
+                case ZYDIS_MNEMONIC_XOR: return binary_form{ 0x30, 6, true };
+                case ZYDIS_MNEMONIC_MOV: return binary_form{ 0x88, 0, false };
+                default:
+                    return std::nullopt;
+            }
+        }
+
+        uint8_t encode_binary(const enc::req& request, const binary_form& form, const uint64_t address, uint8_t* buffer)
+        {
+            if (request.operand_count != 2)
+                return 0;
+
+            const enc::op& src = request.operands[1];
+            const std::optional<operand_info> target = get_rm_operand(request.operands[0]);
+            if (!target)
+                return 0;
+
+            const uint8_t size = target->size;
+
+            encoding enc;
+            enc.set_operand_size(size);
+
+            if (src.type == ZYDIS_OPERAND_TYPE_REGISTER)
+            {
+                const std::optional<gpr> source = get_gpr(src.reg.value);
+                if (!source || source->size != size)
+                    return 0;
+
+                // r/m, r is also used for register to register, r, r/m encodes the same thing with the operands swapped
+                enc.set_opcode(form.base_opcode + (size == 1 ? 0 : 1));
+                enc.reg = source->id;
+                enc.rm = target->rm;
+                enc.needs_rex = source->needs_rex;
+
+                return emit(enc, address, buffer);
+            }
+
+            if (src.type == ZYDIS_OPERAND_TYPE_MEMORY)
+            {
+                if (!target->is_register)
+                    return 0;
+
+                const std::optional<operand_info> source = get_rm_operand(src);
+                if (!source || source->size != size)
+                    return 0;
+
+                enc.set_opcode(form.base_opcode + (size == 1 ? 2 : 3));
+                enc.reg = target->id;
+                enc.rm = source->rm;
+                enc.needs_rex = target->rm.needs_rex;
+
+                return emit(enc, address, buffer);
+            }
+
+            if (src.type != ZYDIS_OPERAND_TYPE_IMMEDIATE)
+                return 0;
+
+            const int64_t imm = src.imm.s;
+            if (form.alu)
+            {
+                if (size == 1)
+                {
+                    if (imm < -128 || imm > 255)
+                        return 0;
+
+                    if (target->is_register && target->id == 0)
+                    {
+                        enc.set_opcode(form.base_opcode + 4);
+                    }
+                    else
+                    {
+                        enc.set_opcode(0x80);
+                        enc.reg = form.extension;
+                        enc.rm = target->rm;
+                    }
+
+                    enc.set_immediate(imm, 1);
+                    return emit(enc, address, buffer);
+                }
+
+                // values that only fit once truncated to the operand size could go either way, zydis decides those
+                const uint8_t imm_size = size == 2 ? 2 : 4;
+                if (!fits_signed(imm, imm_size * 8))
+                    return 0;
+
+                if (fits_signed(imm, 8))
+                {
+                    enc.set_opcode(0x83);
+                    enc.reg = form.extension;
+                    enc.rm = target->rm;
+                    enc.set_immediate(imm, 1);
+                }
+                else if (target->is_register && target->id == 0)
+                {
+                    enc.set_opcode(form.base_opcode + 5);
+                    enc.set_immediate(imm, imm_size);
+                }
+                else
+                {
+                    enc.set_opcode(0x81);
+                    enc.reg = form.extension;
+                    enc.rm = target->rm;
+                    enc.set_immediate(imm, imm_size);
+                }
+
+                return emit(enc, address, buffer);
+            }
+
+            // mov with an immediate
+            const uint8_t imm_size = size == 8 ? 4 : size;
+            if (size == 8 && !fits_signed(imm, 32))
+            {
+                if (!target->is_register)
+                    return 0;
+
+                // movabs is the only form that takes the full 64 bits
+                enc.set_opcode(0xB8 + (target->id & 7));
+                enc.rex |= target->id >= 8 ? rex_b : 0;
+                enc.set_immediate(imm, 8);
+
+                return emit(enc, address, buffer);
+            }
+
+            if (size != 8 && !fits_signed(imm, size * 8) && static_cast<uint64_t>(imm) >> size * 8 != 0)
+                return 0;
+
+            if (target->is_register && size != 8)
+            {
+                enc.set_opcode((size == 1 ? 0xB0 : 0xB8) + (target->id & 7));
+                enc.rex |= target->id >= 8 ? rex_b : 0;
+                enc.needs_rex = target->rm.needs_rex;
+            }
+            else
+            {
+                enc.set_opcode(size == 1 ? 0xC6 : 0xC7);
+                enc.rm = target->rm;
+            }
+
+            enc.set_immediate(imm, imm_size);
+            return emit(enc, address, buffer);
+        }
+
+        uint8_t encode_lea(const enc::req& request, const uint64_t address, uint8_t* buffer)
+        {
+            if (request.operand_count != 2 ||
+                request.operands[0].type != ZYDIS_OPERAND_TYPE_REGISTER ||
+                request.operands[1].type != ZYDIS_OPERAND_TYPE_MEMORY)
+                return 0;
+
+            const std::optional<gpr> target = get_gpr(request.operands[0].reg.value);
+            const std::optional<rm_operand> mem = rm_memory(request.operands[1].mem);
+            if (!target || target->size == 1 || !mem)
+                return 0;
+
+            encoding enc;
+            enc.set_operand_size(target->size);
+            enc.set_opcode(0x8D);
+            enc.reg = target->id;
+            enc.rm = mem;
+
+            return emit(enc, address, buffer);
+        }
+
+        uint8_t encode_shift(const enc::req& request, const uint8_t extension, const uint64_t address, uint8_t* buffer)
+        {
+            if (request.operand_count != 2)
+                return 0;
+
+            const std::optional<operand_info> target = get_rm_operand(request.operands[0]);
+            if (!target)
+                return 0;
+
+            const uint8_t size = target->size;
+            const enc::op& count = request.operands[1];
+
+            encoding enc;
+            enc.set_operand_size(size);
+            enc.reg = extension;
+            enc.rm = target->rm;
+
+            if (count.type == ZYDIS_OPERAND_TYPE_REGISTER && count.reg.value == ZYDIS_REGISTER_CL)
+            {
+                enc.set_opcode(size == 1 ? 0xD2 : 0xD3);
+                return emit(enc, address, buffer);
+            }
+
+            // a count of 1 has its own shorter opcode, zydis decides which one it wants
+            if (count.type != ZYDIS_OPERAND_TYPE_IMMEDIATE || count.imm.u < 2 || count.imm.u > 0xFF)
+                return 0;
+
+            enc.set_opcode(size == 1 ? 0xC0 : 0xC1);
+            enc.set_immediate(count.imm.u, 1);
+
+            return emit(enc, address, buffer);
+        }
+
+        uint8_t encode_stack(const enc::req& request, const uint8_t base_opcode, const uint64_t address, uint8_t* buffer)
+        {
+            if (request.operand_count != 1 || request.operands[0].type != ZYDIS_OPERAND_TYPE_REGISTER)
+                return 0;
+
+            const std::optional<gpr> reg = get_gpr(request.operands[0].reg.value);
+            if (!reg || reg->size != 8)
+                return 0;
+
+            encoding enc;
+            enc.set_opcode(base_opcode + (reg->id & 7));
+            enc.rex = reg->id >= 8 ? rex_b : 0;
+
+            return emit(enc, address, buffer);
+        }
+
+        std::optional<uint8_t> get_condition(const ZydisMnemonic mnemonic)
+        {
+            switch (mnemonic)
+            {
+                case ZYDIS_MNEMONIC_JO: return 0x0;
+                case ZYDIS_MNEMONIC_JNO: return 0x1;
+                case ZYDIS_MNEMONIC_JB: return 0x2;
+                case ZYDIS_MNEMONIC_JNB: return 0x3;
+                case ZYDIS_MNEMONIC_JZ: return 0x4;
+                case ZYDIS_MNEMONIC_JNZ: return 0x5;
+                case ZYDIS_MNEMONIC_JBE: return 0x6;
+                case ZYDIS_MNEMONIC_JNBE: return 0x7;
+                case ZYDIS_MNEMONIC_JS: return 0x8;
+                case ZYDIS_MNEMONIC_JNS: return 0x9;
+                case ZYDIS_MNEMONIC_JP: return 0xA;
+                case ZYDIS_MNEMONIC_JNP: return 0xB;
+                case ZYDIS_MNEMONIC_JL: return 0xC;
+                case ZYDIS_MNEMONIC_JNL: return 0xD;
+                case ZYDIS_MNEMONIC_JLE: return 0xE;
+                case ZYDIS_MNEMONIC_JNLE: return 0xF;
+                default:
+                    return std::nullopt;
+            }
+        }
+
+        /*
+         * jmp and jcc to an absolute target, rel8 is picked whenever it reaches unless the request forces a width
+         */
+        uint8_t encode_branch(const enc::req& request, const std::optional<uint8_t> condition, const uint64_t address, uint8_t* buffer)
+        {
+            const int64_t target = request.operands[0].imm.s;
+
+            const int64_t short_disp = target - static_cast<int64_t>(address + 2);
+            const bool short_fits = fits_signed(short_disp, 8);
+
+            bool use_short;
+            switch (request.branch_width)
+            {
+                case ZYDIS_BRANCH_WIDTH_NONE: use_short = short_fits;
+                    break;
+                case ZYDIS_BRANCH_WIDTH_8:
+                    if (!short_fits)
+                        return 0;
+
+                    use_short = true;
+                    break;
+                case ZYDIS_BRANCH_WIDTH_32: use_short = false;
+                    break;
+                default:
+                    return 0;
+            }
+
+            if (use_short)
+            {
+                buffer[0] = condition ? 0x70 + *condition : 0xEB;
+                buffer[1] = static_cast<uint8_t>(short_disp);
+
+                return 2;
+            }
+
+            uint8_t length = 0;
+            if (condition)
+            {
+                buffer[length++] = 0x0F;
+                buffer[length++] = 0x80 + *condition;
+            }
+            else
+            {
+                buffer[length++] = 0xE9;
+            }
+
+            const int64_t near_disp = target - static_cast<int64_t>(address + length + 4);
+            if (!fits_signed(near_disp, 32))
+                return 0;
+
+            for (uint8_t i = 0; i < 4; i++)
+                buffer[length++] = static_cast<uint8_t>(near_disp >> i * 8);
+
+            return length;
+        }
+
+        uint8_t encode_jmp(const enc::req& request, const uint64_t address, uint8_t* buffer)
+        {
+            if (request.operand_count != 1)
+                return 0;
+
+            const enc::op& target = request.operands[0];
+            if (target.type == ZYDIS_OPERAND_TYPE_IMMEDIATE)
+                return encode_branch(request, std::nullopt, address, buffer);
+
+            const std::optional<operand_info> rm = get_rm_operand(target);
+            if (!rm || rm->size != 8)
+                return 0;
+
+            // near indirect jumps are 64 bit by default and never take rex.w
+            encoding enc;
+            enc.set_opcode(0xFF);
+            enc.reg = 4;
+            enc.rm = rm->rm;
+
+            return emit(enc, address, buffer);
+        }
+
+        /*
+         * movq, pextrq and pinsrq between a general purpose and an xmm register
+         * the xmm register always sits in modrm.reg
+         */
+        uint8_t encode_sse_gpr(const enc::req& request, const uint8_t xmm_index, const uint8_t gpr_index, const uint8_t* opcode,
+            const uint8_t opcode_length, const bool has_imm, const uint64_t address, uint8_t* buffer)
+        {
+            if (request.operand_count != (has_imm ? 3 : 2) ||
+                request.operands[xmm_index].type != ZYDIS_OPERAND_TYPE_REGISTER ||
+                request.operands[gpr_index].type != ZYDIS_OPERAND_TYPE_REGISTER)
+                return 0;
+
+            const std::optional<uint8_t> xmm = get_xmm(request.operands[xmm_index].reg.value);
+            const std::optional<gpr> reg = get_gpr(request.operands[gpr_index].reg.value);
+            if (!xmm || !reg || reg->size != 8)
+                return 0;
+
+            encoding enc;
+            enc.prefix = operand_size_prefix;
+            enc.rex = rex_w;
+            enc.reg = *xmm;
+            enc.rm = rm_register(reg->id);
+
+            enc.set_opcode(opcode, opcode_length);
+
+            if (has_imm)
+            {
+                const enc::op& imm = request.operands[2];
+                if (imm.type != ZYDIS_OPERAND_TYPE_IMMEDIATE || imm.imm.u > 0xFF)
+                    return 0;
+
+                enc.set_immediate(imm.imm.u, 1);
+            }
+
+            return emit(enc, address, buffer);
+        }
+
+        uint8_t encode_movq(const enc::req& request, const uint64_t address, uint8_t* buffer)
+        {
+            if (request.operand_count != 2 || request.operands[0].type != ZYDIS_OPERAND_TYPE_REGISTER)
+                return 0;
+
+            if (get_xmm(request.operands[0].reg.value))
+            {
+                constexpr uint8_t movq_xmm_gpr[] = { 0x0F, 0x6E };
+                return encode_sse_gpr(request, 0, 1, movq_xmm_gpr, 2, false, address, buffer);
+            }
+
+            constexpr uint8_t movq_gpr_xmm[] = { 0x0F, 0x7E };
+            return encode_sse_gpr(request, 1, 0, movq_gpr_xmm, 2, false, address, buffer);
+        }
+    }
+
+    uint8_t fast_encode(const enc::req& request, const uint64_t address, uint8_t* buffer)
+    {
+        // anything asking for a particular encoding is left to zydis
+        if (request.machine_mode != ZYDIS_MACHINE_MODE_LONG_64 || request.prefixes ||
+            (request.allowed_encodings != ZYDIS_ENCODABLE_ENCODING_DEFAULT && !(request.allowed_encodings & ZYDIS_ENCODABLE_ENCODING_LEGACY)) ||
+            request.branch_type != ZYDIS_BRANCH_TYPE_NONE ||
+            request.address_size_hint != ZYDIS_ADDRESS_SIZE_HINT_NONE ||
+            request.operand_size_hint != ZYDIS_OPERAND_SIZE_HINT_NONE)
+            return 0;
+
+        if (const std::optional<binary_form> form = get_binary_form(request.mnemonic))
+            return encode_binary(request, *form, address, buffer);
+
+        if (const std::optional<uint8_t> condition = get_condition(request.mnemonic))
+        {
+            if (request.operand_count != 1 || request.operands[0].type != ZYDIS_OPERAND_TYPE_IMMEDIATE)
+                return 0;
+
+            return encode_branch(request, condition, address, buffer);
+        }
+
+        switch (request.mnemonic)
+        {
+            case ZYDIS_MNEMONIC_LEA:
+                return encode_lea(request, address, buffer);
+            case ZYDIS_MNEMONIC_SHL:
+                return encode_shift(request, 4, address, buffer);
+            case ZYDIS_MNEMONIC_SHR:
+                return encode_shift(request, 5, address, buffer);
+            case ZYDIS_MNEMONIC_PUSH:
+                return encode_stack(request, 0x50, address, buffer);
+            case ZYDIS_MNEMONIC_POP:
+                return encode_stack(request, 0x58, address, buffer);
+            case ZYDIS_MNEMONIC_JMP:
+                return encode_jmp(request, address, buffer);
+            case ZYDIS_MNEMONIC_MOVQ:
+                return encode_movq(request, address, buffer);
+            case ZYDIS_MNEMONIC_PEXTRQ:
+            {
+                constexpr uint8_t pextrq[] = { 0x0F, 0x3A, 0x16 };
+                return encode_sse_gpr(request, 1, 0, pextrq, 3, true, address, buffer);
+            }
+            case ZYDIS_MNEMONIC_PINSRQ:
+            {
+                constexpr uint8_t pinsrq[] = { 0x0F, 0x3A, 0x22 };
+                return encode_sse_gpr(request, 0, 1, pinsrq, 3, true, address, buffer);
+            }
+            case ZYDIS_MNEMONIC_PUSHFQ:
+            case ZYDIS_MNEMONIC_POPFQ:
+                if (request.operand_count != 0)
+                    return 0;
+
+                buffer[0] = request.mnemonic == ZYDIS_MNEMONIC_PUSHFQ ? 0x9C : 0x9D;
+                return 1;
+            default:
+                return 0;
+        }
+    }
+}
@@ -1,7 +1,9 @@
 #include <intrin.h>
+#include <mutex>
 
 #include "eaglevm-core/codec/zydis_helper.h"
 #include "eaglevm-core/codec/zydis_defs.h"
+#include "eaglevm-core/codec/fast_encoder.h"
 
 #include "eaglevm-core/util/assert.h"
 #include "Zydis/Internal/FormatterBase.h"
@@ -10,8 +12,13 @@ namespace eagle::codec
 {
     void setup_decoder()
     {
-        ZydisDecoderInit(&zyids_decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
-        ZydisFormatterInit(&zydis_formatter, ZYDIS_FORMATTER_STYLE_INTEL);
+        // the decoder and formatter are only ever read after this point which makes them safe to share between threads
+        static std::once_flag setup_flag;
+        std::call_once(setup_flag, []
+        {
+            ZydisDecoderInit(&zyids_decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+            ZydisFormatterInit(&zydis_formatter, ZYDIS_FORMATTER_STYLE_INTEL);
+        });
     }
 
     reg get_bit_version(reg input_reg, const reg_size target_size)
@@ -336,18 +343,26 @@ namespace eagle::codec
     std::vector<uint8_t> compile_absolute(enc::req& request, uint32_t address)
     {
         std::vector<uint8_t> instruction_data(ZYDIS_MAX_INSTRUCTION_LENGTH);
+        instruction_data.resize(compile_absolute(request, address, instruction_data.data()));
+
+        return instruction_data;
+    }
+
+    uint8_t compile_absolute(enc::req& request, uint32_t address, uint8_t* buffer)
+    {
+        if (const uint8_t length = fast_encode(request, address, buffer))
+            return length;
+
         ZyanUSize encoded_length = ZYDIS_MAX_INSTRUCTION_LENGTH;
 
-        const ZyanStatus result = ZydisEncoderEncodeInstructionAbsolute(&request, instruction_data.data(),
-            &encoded_length, address);
+        const ZyanStatus result = ZydisEncoderEncodeInstructionAbsolute(&request, buffer, &encoded_length, address);
         if (!ZYAN_SUCCESS(result))
         {
             auto status_code = ZYAN_STATUS_CODE(result);
             __debugbreak();
         }
 
-        instruction_data.resize(encoded_length);
-        return instruction_data;
+        return static_cast<uint8_t>(encoded_length);
     }
 
     std::vector<uint8_t> compile_queue(std::vector<ZydisEncoderRequest>& queue)
@@ -2,16 +2,17 @@
 
 namespace eagle::asmb
 {
-    uint32_t code_container::current_uid = 0;
+    std::atomic_uint32_t code_container::current_uid = 0;
 
     code_container_ptr code_container::create()
     {
-        return std::make_shared<code_container>();
+        return std::allocate_shared<code_container>(util::arena_allocator<code_container>(util::region_arena::current()));
     }
 
     code_container_ptr code_container::create(const std::string& label_name, bool generate_comments)
     {
-        return std::make_shared<code_container>(label_name, generate_comments);
+        return std::allocate_shared<code_container>(util::arena_allocator<code_container>(util::region_arena::current()),
+            label_name, generate_comments);
     }
 
     std::string code_container::get_name()
@@ -31,15 +32,11 @@ namespace eagle::asmb
 
     void code_container::add(codec::encoder::inst_req inst)
     {
-        instruction_list.push_back(inst);
-    }
-
-    std::vector<codec::encoder::inst_req_label_v> code_container::get_instructions() const
-    {
-        return instruction_list;
+        instruction_list.push_back(std::move(inst));
     }
 
     code_container::code_container()
+        : encode_builder(util::region_arena::current())
     {
         is_named = false;
         name = "";
@@ -47,6 +44,7 @@ namespace eagle::asmb
     }
 
     code_container::code_container(const std::string& label_name, bool generate_comments)
+        : encode_builder(util::region_arena::current())
     {
         is_named = generate_comments;
         name = label_name;
@@ -1,19 +1,36 @@
 #include "eaglevm-core/compiler/code_label.h"
 
+#include <atomic>
+
+#include "eaglevm-core/util/region_arena.h"
+
 namespace eagle::asmb
 {
     code_label_ptr code_label::create()
     {
-        return std::make_shared<code_label>();
+        return std::allocate_shared<code_label>(util::arena_allocator<code_label>(util::region_arena::current()));
     }
 
     code_label_ptr code_label::create(const std::string& label_name, bool generate_comments)
     {
-        return std::make_shared<code_label>(label_name, generate_comments);
+        return std::allocate_shared<code_label>(util::arena_allocator<code_label>(util::region_arena::current()),
+            label_name, generate_comments);
+    }
+
+    code_label_ptr code_label::create(const uint64_t name_id, const bool generate_comments)
+    {
+        return std::allocate_shared<code_label>(util::arena_allocator<code_label>(util::region_arena::current()),
+            name_id, generate_comments);
     }
 
     std::string code_label::get_name()
     {
+        if (has_name_id)
+        {
+            name = std::to_string(name_id);
+            has_name_id = false;
+        }
+
         return name;
     }
 
@@ -25,6 +42,7 @@ namespace eagle::asmb
     void code_label::set_name(const std::string& new_name)
     {
         name = new_name;
+        has_name_id = false;
     }
 
     bool code_label::get_is_named() const
@@ -34,21 +52,24 @@ namespace eagle::asmb
 
     int64_t code_label::get_address() const
     {
-        return relative_address;
+        return relative_address.load(std::memory_order_relaxed);
     }
 
     void code_label::set_address(uint64_t address)
     {
-        relative_address = address;
+        relative_address.store(address, std::memory_order_relaxed);
     }
 
-    inline static uint32_t global_uuid = 0;
+    inline static std::atomic_uint32_t global_uuid = 0;
 
     code_label::code_label()
     {
         is_named = false;
         name = "";
 
+        name_id = 0;
+        has_name_id = false;
+
         relative_address = 0;
         uuid = global_uuid++;
     }
@@ -58,6 +79,20 @@ namespace eagle::asmb
         is_named = generate_comments;
         name = label_name;
 
+        name_id = 0;
+        has_name_id = false;
+
+        relative_address = 0;
+        uuid = global_uuid++;
+    }
+
+    code_label::code_label(const uint64_t name_id, const bool generate_comments)
+    {
+        is_named = generate_comments;
+
+        this->name_id = name_id;
+        has_name_id = true;
+
         relative_address = 0;
         uuid = global_uuid++;
     }
@@ -1,26 +1,127 @@
 #include "eaglevm-core/compiler/section_manager.h"
 
-#include <queue>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <mutex>
 
 #include "eaglevm-core/util/random.h"
 
 #include <ranges>
-#include <set>
-#include <unordered_set>
+#include <unordered_map>
 #include <variant>
 
 #include "eaglevm-core/codec/zydis_helper.h"
 
 namespace eagle::asmb
 {
+    namespace
+    {
+        constexpr uint32_t unplaced = UINT32_MAX;
+
+        // jmp rel8 and jcc rel8 are both 2 bytes
+        constexpr int64_t short_branch_size = 2;
+
+        constexpr size_t slot_size = ZYDIS_MAX_INSTRUCTION_LENGTH;
+
+        /*
+         * fenwick tree over the encoded size of every flat item
+         * resizing an item and querying the offset of an item are both O(log n)
+         */
+        class offset_tree
+        {
+        public:
+            explicit offset_tree(const std::vector<uint8_t>& sizes)
+                : tree(sizes.size() + 1)
+            {
+                for (size_t i = 1; i < tree.size(); i++)
+                {
+                    tree[i] += sizes[i - 1];
+
+                    const size_t parent = i + lowbit(i);
+                    if (parent < tree.size())
+                        tree[parent] += tree[i];
+                }
+            }
+
+            void add(const uint32_t index, const int64_t diff)
+            {
+                for (size_t i = index + 1; i < tree.size(); i += lowbit(i))
+                    tree[i] += diff;
+            }
+
+            /*
+             * @return combined size of every item before index
+             */
+            [[nodiscard]] int64_t prefix(const uint32_t index) const
+            {
+                int64_t sum = 0;
+                for (size_t i = index; i > 0; i -= lowbit(i))
+                    sum += tree[i];
+
+                return sum;
+            }
+
+        private:
+            std::vector<int64_t> tree;
+
+            static size_t lowbit(const size_t i)
+            {
+                return i & ~i + 1;
+            }
+        };
+
+        /*
+         * segment tree of fixup intervals, a fixup owning [begin, end) has to be recompiled when any item inside
+         * of the interval is resized. flat indexes do not move during layout so the tree is only built once
+         */
+        class fixup_index
+        {
+        public:
+            explicit fixup_index(const size_t count)
+                : leaves(std::bit_ceil(std::max<size_t>(count, 1))), nodes(leaves * 2)
+            {
+            }
+
+            void insert(const uint32_t begin, const uint32_t end, const uint32_t fixup)
+            {
+                for (size_t l = begin + leaves, r = end + leaves; l < r; l >>= 1, r >>= 1)
+                {
+                    if (l & 1)
+                        nodes[l++].push_back(fixup);
+                    if (r & 1)
+                        nodes[--r].push_back(fixup);
+                }
+            }
+
+            template <typename F>
+            void stab(const uint32_t index, F&& callback) const
+            {
+                for (size_t node = index + leaves; node > 0; node >>= 1)
+                    for (const uint32_t fixup : nodes[node])
+                        callback(fixup);
+            }
+
+        private:
+            size_t leaves;
+            std::vector<std::vector<uint32_t>> nodes;
+        };
+    }
+
     section_manager::section_manager()
     {
         shuffle_functions = false;
+        cache = std::make_shared<encoding_cache>();
     }
 
     section_manager::section_manager(const bool shuffle)
     {
         shuffle_functions = shuffle;
+        cache = std::make_shared<encoding_cache>();
     }
 
     void section_manager::add_code_container(const code_container_ptr& code)
@@ -33,140 +134,509 @@ namespace eagle::asmb
         section_code_containers.append_range(code);
     }
 
-    codec::encoded_vec section_manager::compile_section(uint32_t base)
+    /*
+     * content keyed encodings, only requests that do not depend on their own rva are ever looked up
+     * split into shards so every container layout can share one cache while compiling in parallel
+     */
+    class section_manager::encoding_cache
     {
-        if (shuffle_functions)
-            shuffle_containers();
+    public:
+        uint8_t compile(codec::enc::req& request, uint8_t* out)
+        {
+            const request_key key(request);
+            const size_t hash = request_key_hash{ }(key);
 
-        std::vector<std::vector<uint8_t>> output_encodings;
-        uint64_t base_offset = base;
+            encoding_shard& shard = shards[hash % shard_count];
+            {
+                std::lock_guard lock(shard.mutex);
+                if (const auto it = shard.encodings.find(key); it != shard.encodings.end())
+                {
+                    hits.fetch_add(1, std::memory_order_relaxed);
 
-        std::unordered_map<code_label_ptr, std::set<uint32_t>> label_dependents;
+                    const auto& [length, bytes] = it->second;
+                    std::memcpy(out, bytes.data(), length);
+                    return length;
+                }
+            }
 
-        std::set<uint32_t> rva_dependent_indexes;
-        std::unordered_map<code_label_ptr, uint32_t> label_indexes;
-        std::vector<codec::encoder::inst_req_label_v> flat_segments;
+            misses.fetch_add(1, std::memory_order_relaxed);
 
-        for (const code_container_ptr& code_container : section_code_containers)
+            cached_encoding compiled = { };
+            compiled.length = codec::compile_absolute(request, 0, compiled.bytes.data());
+            std::memcpy(out, compiled.bytes.data(), compiled.length);
+            {
+                std::lock_guard lock(shard.mutex);
+                shard.encodings.try_emplace(key, compiled);
+            }
+
+            return compiled.length;
+        }
+
+        [[nodiscard]] encode_cache_stats get_stats() const
+        {
+            return { hits.load(std::memory_order_relaxed), misses.load(std::memory_order_relaxed) };
+        }
+
+    private:
+        static constexpr size_t operand_limit = std::extent_v<decltype(codec::enc::req::operands)>;
+        static constexpr size_t shard_count = 16;
+
+        /*
+         * every field of the request that changes the encoding, operands only contribute the fields their type uses
+         */
+        struct request_key
         {
-            for (auto& label_code_variant : code_container->get_instructions())
+            std::array<uint64_t, 2 + operand_limit * 2> words = { };
+
+            explicit request_key(const codec::enc::req& request)
             {
-                std::visit([&](auto&& arg)
+                words[0] = static_cast<uint64_t>(request.mnemonic) |
+                    static_cast<uint64_t>(request.operand_count) << 16 |
+                    static_cast<uint64_t>(request.branch_type) << 24 |
+                    static_cast<uint64_t>(request.branch_width) << 32 |
+                    static_cast<uint64_t>(request.address_size_hint) << 40 |
+                    static_cast<uint64_t>(request.operand_size_hint) << 48;
+                words[1] = request.prefixes;
+
+                for (size_t i = 0; i < request.operand_count; i++)
                 {
-                    const uint32_t flat_index = flat_segments.size();
+                    const codec::enc::op& op = request.operands[i];
+
+                    uint64_t& info = words[2 + i * 2];
+                    uint64_t& value = words[3 + i * 2];
 
-                    using T = std::decay_t<decltype(arg)>;
-                    if constexpr (std::is_same_v<T, codec::encoder::inst_req>)
+                    info = op.type;
+                    switch (op.type)
                     {
-                        const codec::encoder::inst_req& inst = arg;
+                        case ZYDIS_OPERAND_TYPE_REGISTER:
+                            info |= static_cast<uint64_t>(op.reg.value) << 8;
+                            break;
+                        case ZYDIS_OPERAND_TYPE_MEMORY:
+                            info |= static_cast<uint64_t>(op.mem.base) << 8 |
+                                static_cast<uint64_t>(op.mem.index) << 24 |
+                                static_cast<uint64_t>(op.mem.scale) << 40 |
+                                static_cast<uint64_t>(op.mem.size) << 48;
+                            value = op.mem.displacement;
+                            break;
+                        case ZYDIS_OPERAND_TYPE_POINTER:
+                            info |= static_cast<uint64_t>(op.ptr.segment) << 8;
+                            value = op.ptr.offset;
+                            break;
+                        case ZYDIS_OPERAND_TYPE_IMMEDIATE:
+                            value = op.imm.u;
+                            break;
+                        default:
+                            break;
+                    }
+                }
+            }
 
-                        // at to label dependency list
-                        for (auto& dependent : inst.get_dependents())
-                            label_dependents[dependent].insert(flat_index);
+            bool operator==(const request_key& other) const = default;
+        };
 
-                        // add to rva dependency list
-                        if (inst.is_rva_dependent())
-                            rva_dependent_indexes.insert(flat_index);
+        struct request_key_hash
+        {
+            size_t operator()(const request_key& key) const
+            {
+                uint64_t hash = 0;
+                for (const uint64_t word : key.words)
+                {
+                    hash = (hash ^ word) * 0x9E3779B97F4A7C15;
+                    hash ^= hash >> 32;
+                }
 
-                        codec::enc::req enc_req = inst.build(base_offset);
-                        attempt_instruction_fix(enc_req);
+                return hash;
+            }
+        };
 
-                        const auto compiled = codec::compile_absolute(enc_req, 0);
-                        output_encodings.push_back(compiled);
+        struct cached_encoding
+        {
+            uint8_t length;
+            std::array<uint8_t, ZYDIS_MAX_INSTRUCTION_LENGTH> bytes;
+        };
 
-                        base_offset += compiled.size();
+        struct encoding_shard
+        {
+            std::mutex mutex;
+            std::unordered_map<request_key, cached_encoding, request_key_hash> encodings;
+        };
 
-                        flat_segments.emplace_back(inst);
-                    }
-                    else if constexpr (std::is_same_v<T, code_label_ptr>)
-                    {
-                        const code_label_ptr& label = arg;
-                        label->set_address(base_offset);
+        std::array<encoding_shard, shard_count> shards;
 
-                        // this is stupid but this lets us properly index into output_encodings
-                        output_encodings.emplace_back();
+        std::atomic_uint64_t hits = 0;
+        std::atomic_uint64_t misses = 0;
+    };
 
-                        VM_ASSERT(!label_indexes.contains(label), "redefined label found");
-                        label_indexes[label] = flat_index;
+    /*
+     * flat layout of a run of instructions and labels. a layout is compiled once per container, where only labels
+     * placed inside of the container get resolved, and the container layouts are then appended into one layout for
+     * the section which resolves everything that is left
+     */
+    class section_manager::section_layout
+    {
+    public:
+        section_layout(const bool relax_branches, encoding_cache* cache)
+            : relax_branches(relax_branches), cache(cache)
+        {
+        }
 
-                        flat_segments.emplace_back(label);
+        /*
+         * compiles an item at the end of the layout, labels that are not placed yet are read as they are
+         */
+        void compile(const codec::encoder::inst_req_label_v& item)
+        {
+            std::visit([&](auto&& arg)
+            {
+                const uint32_t flat_index = flat_segments.size();
+
+                using T = std::decay_t<decltype(arg)>;
+                if constexpr (std::is_same_v<T, codec::encoder::inst_req>)
+                {
+                    const codec::encoder::inst_req& inst = arg;
+
+                    bool rva_dependent = false;
+                    for (const auto& op : inst.operands)
+                    {
+                        std::visit([&](auto&& operand)
+                        {
+                            using O = std::decay_t<decltype(operand)>;
+                            if constexpr (std::is_same_v<O, codec::encoder::imm_label_operand>)
+                                label_refs.emplace_back(flat_index, get_label_id(operand.code_label), operand.relative, false);
+                            else if constexpr (std::is_same_v<O, codec::encoder::imm_op> || std::is_same_v<O, codec::encoder::mem_op>)
+                                rva_dependent |= operand.relative;
+                        }, op);
                     }
-                }, label_code_variant);
+
+                    if (rva_dependent)
+                        rva_dependent_indexes.push_back(flat_index);
+
+                    push_item(item, relax_branches && is_relaxable_branch(inst), true);
+                    output_sizes[flat_index] = compile_inst(flat_index, inst, end_offset);
+                    end_offset += output_sizes[flat_index];
+                }
+                else if constexpr (std::is_same_v<T, code_label_ptr>)
+                {
+                    const code_label_ptr& label = arg;
+                    label->set_address(end_offset);
+
+                    place_label(label, flat_index);
+                    push_item(item, false, false);
+                }
+            }, item);
+        }
+
+        /*
+         * moves every item of a resolved layout to the end of this one, references that were resolved
+         * inside of the other layout stay resolved
+         */
+        void append(section_layout&& other)
+        {
+            const uint32_t flat_offset = flat_segments.size();
+
+            std::vector<uint32_t> label_map(other.labels.size());
+            for (uint32_t label_id = 0; label_id < other.labels.size(); label_id++)
+            {
+                label_map[label_id] = get_label_id(other.labels[label_id]);
+                if (other.label_positions[label_id] != unplaced)
+                    place_label(other.labels[label_id], flat_offset + other.label_positions[label_id]);
             }
+
+            for (const auto& [flat_index, label_id, relative, local] : other.label_refs)
+                label_refs.emplace_back(flat_offset + flat_index, label_map[label_id], relative, local);
+
+            for (const uint32_t flat_index : other.rva_dependent_indexes)
+                rva_dependent_indexes.push_back(flat_offset + flat_index);
+
+            for (uint32_t i = 0; i < other.flat_segments.size(); i++)
+                ref_offsets.push_back(ref_offsets.back() + other.ref_offsets[i + 1] - other.ref_offsets[i]);
+
+            std::ranges::move(other.flat_segments, std::back_inserter(flat_segments));
+            output_slots.append_range(other.output_slots);
+            output_sizes.append_range(other.output_sizes);
+            short_branches.append_range(other.short_branches);
+            narrow_moves.append_range(other.narrow_moves);
+
+            end_offset += other.end_offset;
         }
 
-        std::unordered_set<uint32_t> visited_indexes_set;
-        std::queue<uint32_t> visit_indexes;
-        for (auto& [label, dependent_indexes] : label_dependents)
+        /*
+         * recompiles fixups until no encoding changes size anymore
+         * @param base address of the first item
+         * @param link true when this is the whole section, every label that is still unplaced is outside of it
+         */
+        void resolve(const uint64_t base, const bool link)
         {
-            // find index of where this label is even placed, this way we can pull all the instructions
-            // before it was set, because the instructions after it would have already been compiled.
-            // we found the label we were searching for
-            uint32_t label_index = label_indexes[label];
-            auto it = dependent_indexes.lower_bound(label_index);
+            const uint32_t flat_count = flat_segments.size();
+
+            // the flat indexes never move, only the byte sizes behind them do. a size change at index i shifts every
+            // item after i, so an encoded value is only invalidated if exactly one of its two ends is after i
+            offset_tree offsets(output_sizes);
+            fixup_index fixups(flat_count);
+
+            std::deque<uint32_t> visit_indexes;
+            std::vector<bool> queued(flat_count);
 
-            for (auto dep_it = dependent_indexes.begin(); dep_it != it; ++dep_it)
+            const auto enqueue = [&](const uint32_t index)
             {
-                visit_indexes.push(*dep_it);
+                if (!queued[index])
+                {
+                    queued[index] = true;
+                    visit_indexes.push_back(index);
+                }
+            };
+
+            for (auto& [flat_index, label_id, relative, local] : label_refs)
+            {
+                const uint32_t label_index = label_positions[label_id];
+                if (label_index == unplaced)
+                {
+                    // a container leaves these for the section, which then knows they are not inside of it
+                    if (!link)
+                        continue;
+
+                    // labels from outside of the section keep whatever address they were given, so only the rva of
+                    // a relative reference can change. a branch to one of them can't be relaxed either
+                    if (relative)
+                        fixups.insert(0, flat_index, flat_index);
+
+                    short_branches[flat_index] = false;
+                    enqueue(flat_index);
+                    continue;
+                }
+
+                // label - rva only changes when something between the two is resized
+                // an absolute label changes when anything before it is resized
+                if (relative)
+                    fixups.insert(std::min(flat_index, label_index), std::max(flat_index, label_index), flat_index);
+                else
+                    fixups.insert(0, label_index, flat_index);
+
+                if (link)
+                {
+                    // only relative references inside of a container are independent of where it ends up
+                    if (!relative || !local)
+                        enqueue(flat_index);
+                }
+                else
+                {
+                    // the first pass compiled this before the label was placed
+                    if (label_index > flat_index)
+                        enqueue(flat_index);
+
+                    local = true;
+                }
+            }
+
+            for (const uint32_t flat_index : rva_dependent_indexes)
+            {
+                fixups.insert(0, flat_index, flat_index);
+                if (link)
+                    enqueue(flat_index);
+            }
+
+            while (!visit_indexes.empty())
+            {
+                const uint32_t target_idx = visit_indexes.front();
+                visit_indexes.pop_front();
+                queued[target_idx] = false;
+
+                // labels are only brought up to date for the instructions that read them
+                for (uint32_t i = ref_offsets[target_idx]; i < ref_offsets[target_idx + 1]; i++)
+                {
+                    const uint32_t label_id = label_refs[i].label_id;
+                    if (label_positions[label_id] != unplaced)
+                        labels[label_id]->set_address(base + offsets.prefix(label_positions[label_id]));
+                }
+
+                const auto& inst = std::get<codec::encoder::inst_req>(*flat_segments[target_idx]);
+
+                // recompiled in place, the slot always fits the longest instruction
+                const uint8_t size = compile_inst(target_idx, inst, base + offsets.prefix(target_idx));
+                const int64_t size_diff = static_cast<int64_t>(size) - output_sizes[target_idx];
+
+                if (size_diff != 0)
+                {
+                    output_sizes[target_idx] = size;
+                    offsets.add(target_idx, size_diff);
+
+                    // requeue only the fixups whose interval crosses the resized instruction
+                    fixups.stab(target_idx, enqueue);
+                }
+            }
+
+            for (uint32_t label_id = 0; label_id < labels.size(); label_id++)
+                if (label_positions[label_id] != unplaced)
+                    labels[label_id]->set_address(base + offsets.prefix(label_positions[label_id]));
+
+            end_offset = offsets.prefix(flat_count);
+        }
+
+        [[nodiscard]] uint32_t get_relaxed_bytes() const
+        {
+            uint32_t relaxed_bytes = 0;
+            for (uint32_t i = 0; i < flat_segments.size(); i++)
+                if (short_branches[i])
+                    relaxed_bytes += (std::get<codec::encoder::inst_req>(*flat_segments[i]).mnemonic == codec::m_jmp ? 5 : 6) - short_branch_size;
+
+            return relaxed_bytes;
+        }
+
+        /*
+         * packs the slots down into the final section bytes, the layout can't be used after this
+         */
+        [[nodiscard]] codec::encoded_vec flatten()
+        {
+            // no encoding ever starts after its own slot, so everything can be moved down in place
+            size_t offset = 0;
+            for (size_t i = 0; i < output_sizes.size(); i++)
+            {
+                std::memmove(output_slots.data() + offset, output_slots.data() + i * slot_size, output_sizes[i]);
+                offset += output_sizes[i];
             }
+
+            output_slots.resize(offset);
+            return std::move(output_slots);
         }
 
-        while (!visit_indexes.empty())
+    private:
+        struct label_ref
         {
-            const uint32_t target_idx = visit_indexes.front();
-            visited_indexes_set.erase(target_idx);
-            visit_indexes.pop();
+            uint32_t flat_index;
+            uint32_t label_id;
+            bool relative;
+
+            // resolved by the layout of the container the reference is in
+            bool local;
+        };
+
+        bool relax_branches;
+        encoding_cache* cache;
 
-            // basically we want to recompile all the instructions in the visit indexes
-            // if it changes size, this is a problem because that means all the labels after get redefined
-            const size_t original_size = output_encodings[target_idx].size();
-            const auto& inst = std::get<codec::encoder::inst_req>(flat_segments[target_idx]);
+        uint64_t end_offset = 0;
 
-            uint64_t offset = base;
-            for (auto i = 0; i < target_idx; i++)
-                offset += output_encodings[i].size();
+        // items are read straight out of their containers, which outlive the layout
+        std::vector<const codec::encoder::inst_req_label_v*> flat_segments;
+        // every item owns a slot the size of the longest instruction, so a recompile never moves anything
+        codec::encoded_vec output_slots;
+        std::vector<uint8_t> output_sizes;
 
-            codec::enc::req enc_req = inst.build(offset);
+        // labels get a dense id the first time they are seen, everything after that works on ids
+        std::unordered_map<code_label*, uint32_t> label_ids;
+        std::vector<code_label_ptr> labels;
+        std::vector<uint32_t> label_positions;
+
+        // label references of flat item i are [ref_offsets[i], ref_offsets[i + 1]) in label_refs
+        std::vector<label_ref> label_refs;
+        std::vector<uint32_t> ref_offsets = { 0 };
+        std::vector<uint32_t> rva_dependent_indexes;
+
+        // branches currently encoded in their rel8 form, they only ever get widened so layout always converges
+        std::vector<bool> short_branches;
+
+        // same idea for "mov r64, imm" narrowed to "mov r32, imm32", a label can push the immediate out of range
+        std::vector<bool> narrow_moves;
+
+        uint32_t get_label_id(const code_label_ptr& label)
+        {
+            const auto [it, inserted] = label_ids.try_emplace(label.get(), labels.size());
+            if (inserted)
+            {
+                labels.push_back(label);
+                label_positions.push_back(unplaced);
+            }
+
+            return it->second;
+        }
+
+        void place_label(const code_label_ptr& label, const uint32_t flat_index)
+        {
+            const uint32_t label_id = get_label_id(label);
+            VM_ASSERT(label_positions[label_id] == unplaced, "redefined label found");
+            label_positions[label_id] = flat_index;
+        }
+
+        void push_item(const codec::encoder::inst_req_label_v& item, const bool short_branch, const bool narrow_move)
+        {
+            flat_segments.push_back(&item);
+            output_slots.resize(output_slots.size() + slot_size);
+            output_sizes.push_back(0);
+            ref_offsets.push_back(label_refs.size());
+
+            short_branches.push_back(short_branch);
+            narrow_moves.push_back(narrow_move);
+        }
+
+        uint8_t compile_inst(const uint32_t flat_index, const codec::encoder::inst_req& inst, const uint64_t rva)
+        {
+            codec::enc::req enc_req = inst.build(rva);
             attempt_instruction_fix(enc_req);
 
-            const std::vector<uint8_t> compiled = codec::compile_absolute(enc_req, 0);
-            output_encodings[target_idx] = compiled;
+            if (narrow_moves[flat_index])
+                narrow_moves[flat_index] = attempt_mov_narrow(enc_req);
 
-            if (compiled.size() != original_size)
+            if (short_branches[flat_index])
             {
-                // this means that every label after gets redefined
-                // we want to collect all the labels defined after this current index
-                for (auto& [label, label_idx] : label_indexes)
+                const uint32_t label_id = label_refs[ref_offsets[flat_index]].label_id;
+                if (label_positions[label_id] == unplaced)
                 {
-                    if (label_idx > target_idx)
-                    {
-                        // this label got redefined
-                        // means everything using the label including the label is now invalid
-                        for (auto& dependents : label_dependents | std::views::values)
-                            for (auto& dependent : dependents)
-                                if (std::get<1>(visited_indexes_set.insert(dependent)))
-                                    visit_indexes.push(dependent);
-
-                        // we also want to update the label based on the size change
-                        const int32_t diff = static_cast<int64_t>(compiled.size()) - static_cast<int64_t>(original_size);
-                        label->set_address(label->get_address() + diff);
-                    }
+                    // the target is unknown until the label is placed, it gets recompiled once it is
+                    enc_req.operands[0].imm.s = short_branch_size;
+                    enc_req.branch_width = ZYDIS_BRANCH_WIDTH_8;
                 }
-
-                // this also means that every instruction that was depending on the rva, after has changed
-                for (auto dep_it = rva_dependent_indexes.upper_bound(target_idx); dep_it != rva_dependent_indexes.end(); ++dep_it)
+                else
                 {
-                    visit_indexes.push(*dep_it);
+                    // the immediate is the target relative to the start of the branch
+                    const int64_t displacement = enc_req.operands[0].imm.s - short_branch_size;
+                    if (displacement >= INT8_MIN && displacement <= INT8_MAX)
+                        enc_req.branch_width = ZYDIS_BRANCH_WIDTH_8;
+                    else
+                        short_branches[flat_index] = false;
                 }
             }
+
+            uint8_t* slot = output_slots.data() + flat_index * slot_size;
+
+            // the rva of anything relative is baked into its request, there is no point in caching those
+            if (cache && !inst.is_rva_dependent())
+                return cache->compile(enc_req, slot);
+
+            return codec::compile_absolute(enc_req, 0, slot);
         }
+    };
+
+    codec::encoded_vec section_manager::compile_section(const uint32_t base)
+    {
+        if (shuffle_functions)
+            shuffle_containers();
+
+        std::vector<section_layout> layouts;
+        layouts.reserve(section_code_containers.size());
 
-        // lets not talk about this
-        std::vector<uint8_t> flat_vec;
-        for (const auto& vec : output_encodings)
-            std::ranges::copy(vec, std::back_inserter(flat_vec));
+        for (const code_container_ptr& code_container : section_code_containers)
+            layouts.push_back(compile_container(code_container));
 
-        return flat_vec;
+        return link_section(layouts, base);
+    }
+
+    codec::encoded_vec section_manager::compile_section(const uint32_t base, util::thread_pool& pool)
+    {
+        if (shuffle_functions)
+            shuffle_containers();
+
+        // containers only write to the labels placed inside of them, anything else is read and fixed up when linking
+        std::vector<std::future<section_layout>> jobs;
+        jobs.reserve(section_code_containers.size());
+
+        for (const code_container_ptr& code_container : section_code_containers)
+            jobs.push_back(pool.submit([this, code_container] { return compile_container(code_container); }));
+
+        std::vector<section_layout> layouts;
+        layouts.reserve(jobs.size());
+
+        for (auto& job : jobs)
+            layouts.push_back(job.get());
+
+        return link_section(layouts, base);
     }
 
     std::vector<std::string> section_manager::generate_comments(const std::string& output) const
@@ -201,6 +671,80 @@ namespace eagle::asmb
         std::ranges::shuffle(section_code_containers, util::ran_device::get().gen);
     }
 
+    section_manager::section_layout section_manager::compile_container(const code_container_ptr& code_container) const
+    {
+        section_layout layout(relax_branches, cache.get());
+        for (const auto& label_code_variant : code_container->get_instructions())
+            layout.compile(label_code_variant);
+
+        // every container is laid out from 0, only its relative references are final after this
+        layout.resolve(0, false);
+        return layout;
+    }
+
+    codec::encoded_vec section_manager::link_section(std::vector<section_layout>& layouts, const uint32_t base)
+    {
+        section_layout section(relax_branches, cache.get());
+        for (section_layout& layout : layouts)
+            section.append(std::move(layout));
+
+        section.resolve(base, true);
+        relaxed_bytes = section.get_relaxed_bytes();
+
+        return section.flatten();
+    }
+
+    encode_cache_stats section_manager::get_cache_stats() const
+    {
+        return cache->get_stats();
+    }
+
+    void section_manager::set_branch_relaxation(const bool relax)
+    {
+        relax_branches = relax;
+    }
+
+    uint32_t section_manager::get_relaxed_bytes() const
+    {
+        return relaxed_bytes;
+    }
+
+    bool section_manager::is_relaxable_branch(const codec::encoder::inst_req& inst)
+    {
+        // the rcx and mask register branches only have a rel8 form to begin with
+        constexpr codec::mnemonic rel8_only[] = {
+            codec::m_jcxz, codec::m_jecxz, codec::m_jrcxz, codec::m_jknzd, codec::m_jkzd
+        };
+
+        if (!is_jmp_or_jcc(inst.mnemonic) || std::ranges::contains(rel8_only, inst.mnemonic))
+            return false;
+
+        if (inst.operands.size() != 1)
+            return false;
+
+        const auto* label_op = std::get_if<codec::encoder::imm_label_operand>(&inst.operands[0]);
+        return label_op && label_op->relative && !label_op->negative;
+    }
+
+    bool section_manager::attempt_mov_narrow(codec::enc::req& request)
+    {
+        if (request.mnemonic != ZYDIS_MNEMONIC_MOV || request.operand_count != 2)
+            return false;
+
+        auto& dest = request.operands[0];
+        const auto& src = request.operands[1];
+        if (dest.type != ZYDIS_OPERAND_TYPE_REGISTER || src.type != ZYDIS_OPERAND_TYPE_IMMEDIATE)
+            return false;
+
+        if (codec::get_reg_class(dest.reg.value) != codec::gpr_64 || src.imm.u > UINT32_MAX)
+            return false;
+
+        // writing the 32 bit register zero extends, so the result is the same 64 bit value
+        // this is 5 bytes instead of 7 for the sign extended imm32 form or 10 for imm64
+        dest.reg.value = static_cast<codec::zydis_register>(codec::get_bit_version(dest.reg.value, codec::gpr_32));
+        return true;
+    }
+
     void section_manager::attempt_instruction_fix(codec::enc::req& request)
     {
         if (request.mnemonic == ZYDIS_MNEMONIC_LEA)
@@ -219,39 +763,7 @@ namespace eagle::asmb
                 request.branch_width = ZYDIS_BRANCH_WIDTH_32;
         }
 
-        {
-            // hint branch width for a few instructions
-            // i dont know if there is a better way of doing this
-            // i wish it was generic and i could automatically do this but eh
-
-            // this actually does nothing in zydis, for some reason they dont want to add a feature
-            // where you can hint at the immediate operand width.... ?
-
-            //constexpr codec::mnemonic force_resize_insts[] = {
-            //    codec::m_add, codec::m_sub, codec::m_xor, codec::m_and,
-            //    codec::m_or,
-            //};
-//
-            //if (std::ranges::contains(force_resize_insts, request.mnemonic))
-            //{
-            //    if (request.operands[0].type == ZYDIS_OPERAND_TYPE_REGISTER &&
-            //        request.operands[1].type == ZYDIS_OPERAND_TYPE_IMMEDIATE)
-            //    {
-            //        switch (codec::get_reg_size(request.operands[0].reg.value))
-            //        {
-            //            case codec::bit_64:
-            //            case codec::bit_32:
-            //                request.operand_size_hint = ZYDIS_OPERAND_SIZE_HINT_32;
-            //                break;
-            //            case codec::bit_16:
-            //                request.operand_size_hint =  ZYDIS_OPERAND_SIZE_HINT_16;
-            //                break;
-            //            case codec::bit_8:
-            //                request.operand_size_hint =  ZYDIS_OPERAND_SIZE_HINT_8;
-            //                break;
-            //        }
-            //    }
-            //}
-        }
+        // there is no need to hint immediate or displacement widths, zydis already picks imm8 and disp8 whenever the
+        // value fits. the only shorter form it can't pick on its own is the 32 bit mov, see attempt_mov_narrow
     }
 }
@@ -1,119 +1,255 @@
 #include "eaglevm-core/disassembler/analysis/liveness.h"
+#include <deque>
 #include <ranges>
-#include <unordered_set>
 
 namespace eagle::dasm::analysis
 {
     liveness::liveness(segment_dasm_ptr segment)
         : segment(std::move(segment))
     {
+        build_cfg();
     }
 
-    void liveness::analyze_cross_liveness(const basic_block_ptr& exit_block)
+    void liveness::analyze_cross_liveness()
     {
-        bool changed = true;
-        while (changed)
+        // every block starts on the worklist, after that a block is only revisited when one of its successors changed
+        solve(postorder);
+    }
+
+    void liveness::solve(const std::vector<uint32_t>& initial)
+    {
+        std::vector<bool> queued(block_live.size(), false);
+        std::deque<uint32_t> worklist(initial.begin(), initial.end());
+        for (const uint32_t idx : initial)
+            queued[idx] = true;
+
+        while (!worklist.empty())
         {
-            changed = false;
-            for (auto i = segment->get_blocks().size(); i--;)
-            {
-                const basic_block_ptr& block = segment->get_blocks()[i];
+            const uint32_t idx = worklist.front();
+            worklist.pop_front();
+            queued[idx] = false;
 
-                auto search_jump = [this](const branch_info_t branch) ->
-                    std::optional<basic_block_ptr>
-                {
-                    if (!branch.is_resolved)
-                        return std::nullopt;
+            // OUT[B], whatever runs after the segment is assumed to read every register and flag
+            liveness_info new_out = leaves_segment[idx] ? liveness_info::all() : liveness_info{ };
+            for (const uint32_t succ : successors[idx])
+                new_out |= block_live[succ].first;
+
+            // IN[B]
+            const auto& [use_set, def_set] = block_use_def[idx];
+            liveness_info new_in = use_set | (new_out - def_set);
 
-                    if (auto val = segment->get_block(branch.target_rva, false))
-                        return val;
+            auto& [block_in, block_out] = block_live[idx];
+            if (new_out != block_out)
+            {
+                block_out = new_out;
+                inst_slots[idx].live_valid = false;
+            }
 
-                    return std::nullopt;
-                };
+            if (new_in == block_in)
+                continue;
 
-                // OUT[B]
-                liveness_info new_out = { };
-                switch (block->get_end_reason())
+            block_in = new_in;
+            for (const uint32_t pred : predecessors[idx])
+            {
+                if (!queued[pred])
                 {
-                    case block_conditional_jump:
-                        if (auto search = search_jump(block->branches.front()))
-                            new_out |= live[search.value()].first;
-                    case block_end:
-                    case block_jump:
-                        if (auto search = search_jump(block->branches.back()))
-                            new_out |= live[search.value()].first;
-                        break;
+                    queued[pred] = true;
+                    worklist.push_back(pred);
                 }
+            }
+        }
 
-                // IN[B]
-                auto [use_set, def_set] = block_use_def[block];
+        // profit??
+    }
 
-                const liveness_info diff = new_out - def_set;
-                liveness_info new_in = use_set | diff;
+    std::span<const std::pair<liveness_info, liveness_info>> liveness::analyze_block(const basic_block_ptr& block)
+    {
+        const uint32_t idx = get_index(block);
+        auto& [offset, count, live_valid] = inst_slots[idx];
 
-                if (new_out != live[block].second || new_in != live[block].first)
-                    changed = true;
+        if (!live_valid)
+        {
+            // instructions in a block are straight line code so a single backwards sweep is already the fixed point
+            liveness_info new_out = block_live[idx].second;
+            for (auto i = offset + count; i-- > offset;)
+            {
+                // IN[B]
+                const auto& [use_set, def_set] = inst_use_def[i];
+                liveness_info new_in = use_set | (new_out - def_set);
+                inst_live[i] = { new_in, new_out };
 
-                live[block].first = new_in;
-                live[block].second = new_out;
+                // OUT[B] of the previous instruction
+                new_out = new_in;
             }
+
+            live_valid = true;
         }
 
-        // profit??
+        return { inst_live.data() + offset, count };
     }
 
-    std::vector<std::pair<liveness_info, liveness_info>> liveness::analyze_block(const basic_block_ptr& block)
+    const std::pair<liveness_info, liveness_info>& liveness::analyze_block_at(const basic_block_ptr& block, const size_t idx)
     {
-        std::vector<std::pair<liveness_info, liveness_info>> instruction_live(block->decoded_insts.size());
+        return analyze_block(block)[idx];
+    }
 
-        bool changed = true;
-        while (changed)
+    void liveness::compute_blocks_use_def()
+    {
+        for (uint32_t i = 0; i < inst_slots.size(); i++)
+            compute_block_use_def(i);
+    }
+
+    void liveness::invalidate_block(const basic_block_ptr& block)
+    {
+        const uint32_t idx = get_index(block);
+
+        // a block that changed size gets a new slot at the back, the old one is simply abandoned
+        inst_slot& slot = inst_slots[idx];
+        if (slot.count != block->decoded_insts.size())
         {
-            changed = false;
-            for (auto i = block->decoded_insts.size(); i--;)
-            {
-                // OUT[B]
-                liveness_info new_out;
-                if (i == block->decoded_insts.size() - 1) new_out = live[block].second;
-                else new_out = instruction_live[i + 1].first;
+            slot.offset = static_cast<uint32_t>(inst_use_def.size());
+            slot.count = static_cast<uint32_t>(block->decoded_insts.size());
 
-                // IN[B]
-                liveness_info use_set, def_set;
-                compute_inst_use_def(block->decoded_insts[i], use_set, def_set);
+            inst_use_def.resize(inst_use_def.size() + slot.count);
+            inst_live.resize(inst_live.size() + slot.count);
+        }
 
-                const liveness_info diff = new_out - def_set;
-                liveness_info new_in = use_set | diff;
+        // only the changed block and whatever its new IN reaches backwards have to be solved again. starting from the old
+        // solution a register that stopped being used can stay live around a loop, which is safe, just not minimal
+        compute_block_use_def(idx);
+        solve({ idx });
+    }
 
-                if (new_in != instruction_live[i].first || new_out != instruction_live[i].second)
-                    changed = true;
+    void liveness::compute_block_use_def(const uint32_t idx)
+    {
+        const basic_block_ptr& block = segment->get_blocks()[idx];
+        auto& [offset, count, live_valid] = inst_slots[idx];
 
-                instruction_live[i] = { new_in, new_out };
-            }
+        // the block summary folds every instruction in program order, a register only counts as used by the block
+        // when it is read before anything in the block wrote it
+        liveness_info use, def = { };
+        for (uint32_t i = 0; i < count; i++)
+        {
+            auto& [inst_use, inst_def] = inst_use_def[offset + i];
+            inst_use = { };
+            inst_def = { };
+            compute_inst_use_def(block->decoded_insts[i], inst_use, inst_def);
+
+            use |= inst_use - def;
+            def |= inst_def;
         }
 
-        return instruction_live;
+        block_use_def[idx] = { use, def };
+        live_valid = false;
     }
 
-    std::pair<liveness_info, liveness_info> liveness::analyze_block_at(const basic_block_ptr& block, const size_t idx)
+    bool liveness::contains(const basic_block_ptr& block) const
     {
-        const std::vector<std::pair<liveness_info, liveness_info>> instruction_live
-            = analyze_block(block);
+        return block_index.contains(block);
+    }
 
-        return instruction_live[idx];
+    const std::pair<liveness_info, liveness_info>& liveness::get_live(const basic_block_ptr& block) const
+    {
+        return block_live[get_index(block)];
     }
 
-    void liveness::compute_blocks_use_def()
+    void liveness::build_cfg()
     {
-        for (auto& block : segment->get_blocks())
+        const std::vector<basic_block_ptr>& blocks = segment->get_blocks();
+
+        block_index.reserve(blocks.size());
+        for (uint32_t i = 0; i < blocks.size(); i++)
+            block_index[blocks[i]] = i;
+
+        successors.resize(blocks.size());
+        predecessors.resize(blocks.size());
+        block_live.resize(blocks.size());
+        block_use_def.resize(blocks.size());
+        leaves_segment.resize(blocks.size());
+
+        inst_slots.resize(blocks.size());
+        for (uint32_t i = 0, offset = 0; i < blocks.size(); i++)
+        {
+            const auto count = static_cast<uint32_t>(blocks[i]->decoded_insts.size());
+            inst_slots[i] = { offset, count, false };
+            offset += count;
+        }
+
+        const uint32_t inst_count = inst_slots.empty() ? 0 : inst_slots.back().offset + inst_slots.back().count;
+        inst_use_def.resize(inst_count);
+        inst_live.resize(inst_count);
+
+        for (uint32_t i = 0; i < blocks.size(); i++)
+        {
+            const basic_block_ptr& block = blocks[i];
+            auto add_edge = [&](const branch_info_t& branch)
+            {
+                const basic_block_ptr target = branch.is_resolved ? segment->get_block(branch.target_rva, false) : nullptr;
+                if (target == nullptr)
+                {
+                    leaves_segment[i] = true;
+                    return;
+                }
+
+                const uint32_t target_idx = block_index[target];
+                successors[i].push_back(target_idx);
+                predecessors[target_idx].push_back(i);
+            };
+
+            switch (block->get_end_reason())
+            {
+                case block_conditional_jump:
+                    add_edge(block->branches.front());
+                case block_end:
+                case block_jump:
+                    add_edge(block->branches.back());
+                    break;
+                case block_ret:
+                    leaves_segment[i] = true;
+                    break;
+            }
+        }
+
+        // iterative dfs, blocks unreachable from the first root get picked up by the outer loop
+        std::vector<bool> visited(blocks.size(), false);
+        std::vector<std::pair<uint32_t, size_t>> stack;
+
+        postorder.reserve(blocks.size());
+        for (uint32_t root = 0; root < blocks.size(); root++)
         {
-            liveness_info use, def = { };
-            for (const auto& decoded_inst : block->decoded_insts)
-                compute_inst_use_def(decoded_inst, use, def);
+            if (visited[root])
+                continue;
+
+            visited[root] = true;
+            stack.emplace_back(root, 0);
 
-            block_use_def[block] = { use, def };
+            while (!stack.empty())
+            {
+                auto& [idx, next_succ] = stack.back();
+                if (next_succ < successors[idx].size())
+                {
+                    const uint32_t succ = successors[idx][next_succ++];
+                    if (!visited[succ])
+                    {
+                        visited[succ] = true;
+                        stack.emplace_back(succ, 0);
+                    }
+
+                    continue;
+                }
+
+                postorder.push_back(idx);
+                stack.pop_back();
+            }
         }
     }
 
+    uint32_t liveness::get_index(const basic_block_ptr& block) const
+    {
+        VM_ASSERT(block_index.contains(block), "block does not belong to the analyzed segment");
+        return block_index.at(block);
+    }
+
     liveness_info liveness::compute_inst_flags(const codec::dec::inst_info& inst_info)
     {
         liveness_info liveness = { };
@@ -124,7 +260,7 @@ namespace eagle::dasm::analysis
         return liveness;
     }
 
-    void liveness::compute_inst_use_def(codec::dec::inst_info inst_info, liveness_info& use, liveness_info& def)
+    void liveness::compute_inst_use_def(const codec::dec::inst_info& inst_info, liveness_info& use, liveness_info& def)
     {
         auto& [inst, operands] = inst_info;
         auto handle_register = [&](codec::reg reg, const bool read)
@@ -211,6 +347,6 @@ namespace eagle::dasm::analysis
         def.insert_flags(inst.cpu_flags->set_0);
         def.insert_flags(inst.cpu_flags->set_1);
 
-        use = use - def;
+        // use and def stay separate, "add rax, rbx" reads rax before it writes it so rax is live going into it
     }
 }
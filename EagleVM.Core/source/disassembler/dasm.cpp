@@ -5,13 +5,14 @@
 namespace eagle::dasm
 {
     segment_dasm::segment_dasm(const uint64_t rva_base, uint8_t* buffer, const size_t size):
-        rva_base(rva_base), instruction_buffer(buffer), instruction_size(size)
+        rva_base(rva_base), instruction_buffer(buffer), instruction_size(size), decode_index(size, UINT32_MAX)
     {
     }
 
     std::vector<basic_block_ptr> segment_dasm::explore_blocks(const uint64_t entry_rva)
     {
         std::vector<basic_block_ptr> collected_blocks;
+        std::map<uint64_t, basic_block_ptr> index;
 
         std::unordered_set<uint64_t> discovered;
         std::queue<uint64_t> explore_queue;
@@ -28,40 +29,34 @@ namespace eagle::dasm
 
                 // check if we are in the middle of an already existing block
                 // if so, we split up the block and we just continue
-                bool should_continue = false;
-                for (const auto& existing : collected_blocks)
+                if (const basic_block_ptr existing = find_containing(index, layer_rva))
                 {
-                    if (layer_rva >= existing->start_rva && layer_rva < existing->end_rva_inc)
-                    {
-                        auto prev = std::make_shared<basic_block>();
-                        prev->start_rva = existing->start_rva;
-                        prev->end_rva_inc = prev->start_rva;
-
-                        existing->start_rva = layer_rva;
-
-                        while (prev->end_rva_inc < layer_rva)
-                        {
-                            auto block_inst = existing->decoded_insts.front();
-                            prev->decoded_insts.push_back(block_inst);
-                            existing->decoded_insts.erase(existing->decoded_insts.begin());
-
-                            prev->end_rva_inc += block_inst.instruction.length;
-                        }
-
-                        // this means there is some tricky control flow happening
-                        // for instance, there may be an opaque branch to some garbage code
-                        // another reason could be is we explored the wrong branch first of some obfuscated code and found garbage
-                        // this will not happen with normally compiled code
-                        VM_ASSERT(prev->end_rva_inc == layer_rva, "resulting jump is between an already explored instruction");
-                        collected_blocks.push_back(prev);
-
-                        should_continue = true;
-                        break;
-                    }
-                }
-
-                if (should_continue)
+                    auto prev = std::make_shared<basic_block>();
+                    prev->start_rva = existing->start_rva;
+                    prev->end_rva_inc = prev->start_rva;
+
+                    size_t split_index = 0;
+                    while (prev->end_rva_inc < layer_rva)
+                        prev->end_rva_inc += existing->decoded_insts[split_index++].instruction.length;
+
+                    // move the leading instructions over in one go instead of erasing from the front
+                    const auto split_point = existing->decoded_insts.begin() + split_index;
+                    prev->decoded_insts.assign(existing->decoded_insts.begin(), split_point);
+                    existing->decoded_insts.erase(existing->decoded_insts.begin(), split_point);
+
+                    existing->start_rva = layer_rva;
+
+                    // this means there is some tricky control flow happening
+                    // for instance, there may be an opaque branch to some garbage code
+                    // another reason could be is we explored the wrong branch first of some obfuscated code and found garbage
+                    // this will not happen with normally compiled code
+                    VM_ASSERT(prev->end_rva_inc == layer_rva, "resulting jump is between an already explored instruction");
+                    collected_blocks.push_back(prev);
+
+                    index[prev->start_rva] = prev;
+                    index[existing->start_rva] = existing;
                     continue;
+                }
 
                 auto block = std::make_shared<basic_block>();
                 block->start_rva = layer_rva;
@@ -72,15 +67,11 @@ namespace eagle::dasm
                     // we must do a check to see if our rva is at some already existing block,
                     // if so, we are going to end this block
                     bool force_create = false;
-                    for (const auto& created_block : collected_blocks)
+                    if (const basic_block_ptr created_block = find_containing(index, current_rva))
                     {
-                        if (current_rva >= created_block->start_rva && current_rva < created_block->end_rva_inc)
-                        {
-                            // we are inside
-                            VM_ASSERT(current_rva == created_block->start_rva, "instruction overlap caused by seeking block");
-                            force_create = true;
-                            break;
-                        }
+                        // we are inside
+                        VM_ASSERT(current_rva == created_block->start_rva, "instruction overlap caused by seeking block");
+                        force_create = true;
                     }
 
                     if (force_create || current_rva >= rva_base + instruction_size)
@@ -114,6 +105,7 @@ namespace eagle::dasm
 
                 block->end_rva_inc = current_rva;
                 collected_blocks.push_back(block);
+                index[block->start_rva] = block;
             }
         }
 
@@ -128,6 +120,8 @@ namespace eagle::dasm
         }
 
         blocks = collected_blocks;
+        block_index = std::move(index);
+
         return collected_blocks;
     }
 
@@ -136,11 +130,7 @@ namespace eagle::dasm
         basic_block_ptr block = std::make_shared<basic_block>();
         while (rva_begin < rva_end)
         {
-            codec::dec::inst_info inst = codec::get_instruction(
-                instruction_buffer,
-                instruction_size,
-                rva_begin - rva_base
-            );
+            const codec::dec::inst_info& inst = get_cached(rva_begin).decode;
 
             block->decoded_insts.push_back(inst);
             rva_begin += inst.instruction.length;
@@ -151,19 +141,23 @@ namespace eagle::dasm
 
     basic_block_ptr segment_dasm::get_block(const uint32_t rva, bool inclusive)
     {
-        for (auto block : blocks)
-        {
-            if (inclusive)
-            {
-                if (rva >= block->start_rva && rva < block->end_rva_inc)
-                    return block;
-            }
-            else
-            {
-                if (rva == block->start_rva)
-                    return block;
-            }
-        }
+        if (inclusive)
+            return find_containing(block_index, rva);
+
+        const auto it = block_index.find(rva);
+        return it != block_index.end() ? it->second : nullptr;
+    }
+
+    basic_block_ptr segment_dasm::find_containing(const std::map<uint64_t, basic_block_ptr>& index, const uint64_t rva)
+    {
+        // the first block starting after rva, the one before it is the only candidate
+        auto it = index.upper_bound(rva);
+        if (it == index.begin())
+            return nullptr;
+
+        const basic_block_ptr& block = std::prev(it)->second;
+        if (rva < block->end_rva_inc)
+            return block;
 
         return nullptr;
     }
@@ -191,22 +185,43 @@ namespace eagle::dasm
 
     std::pair<codec::dec::inst_info, uint8_t> segment_dasm::decode_instruction(const uint64_t rva)
     {
-        codec::dec::inst_info inst = codec::get_instruction(
-            instruction_buffer,
-            instruction_size,
-            rva - rva_base
-        );
-
+        const codec::dec::inst_info& inst = get_cached(rva).decode;
         return { inst, inst.instruction.length };
     }
 
-    std::vector<branch_info_t> segment_dasm::get_branches(uint64_t rva)
+    std::vector<branch_info_t> segment_dasm::get_branches(const uint64_t rva)
+    {
+        const cached_inst& cached = get_cached(rva);
+        if (!cached.branches.empty())
+            return cached.branches;
+
+        // straight line instructions only fall through, there is nothing worth keeping around for them
+        return { branch_info_t{ true, false, rva + cached.decode.instruction.length } };
+    }
+
+    const segment_dasm::cached_inst& segment_dasm::get_cached(const uint64_t rva)
+    {
+        const uint64_t offset = rva - rva_base;
+        VM_ASSERT(offset < instruction_size, "attempted to decode outside of the segment");
+
+        uint32_t& entry = decode_index[offset];
+        if (entry != UINT32_MAX)
+            return decode_cache[entry];
+
+        cached_inst& cached = decode_cache.emplace_back();
+        cached.decode = codec::get_instruction(instruction_buffer, instruction_size, offset);
+
+        const auto mnemonic = static_cast<codec::mnemonic>(cached.decode.instruction.mnemonic);
+        if (mnemonic == codec::m_ret || is_jmp_or_jcc(mnemonic))
+            cached.branches = resolve_branches(cached.decode, rva);
+
+        entry = static_cast<uint32_t>(decode_cache.size() - 1);
+        return cached;
+    }
+
+    std::vector<branch_info_t> segment_dasm::resolve_branches(const codec::dec::inst_info& inst, const uint64_t rva)
     {
-        auto [instruction, operands] = codec::get_instruction(
-            instruction_buffer,
-            instruction_size,
-            rva - rva_base
-        );
+        const auto& [instruction, operands] = inst;
 
         std::vector<branch_info_t> branches;
         if (instruction.mnemonic == codec::m_ret)
@@ -0,0 +1,74 @@
+#include "eaglevm-core/pe/function_index.h"
+
+#include <algorithm>
+#include <future>
+
+namespace eagle::pe
+{
+    function_index::function_index(win::image_x64_t* image)
+        : image(image)
+    {
+        const auto exception_data_dir = image->get_nt_headers()->optional_header.data_directories.exception_directory;
+        const auto exception_data_dir_count = exception_data_dir.size / sizeof(win::runtime_function_t);
+
+        const win::runtime_function_t* exception_dir = image->rva_to_ptr<win::runtime_function_t>(exception_data_dir.rva);
+
+        functions.reserve(exception_data_dir_count);
+        for (auto i = 0; i < exception_data_dir_count; i++)
+            functions.emplace_back(exception_dir[i].rva_begin, exception_dir[i].rva_end);
+
+        // the linker already emits these sorted but nothing requires it to
+        std::ranges::sort(functions, { }, &function_range::rva_begin);
+    }
+
+    const function_range* function_index::find_function(const uint32_t rva) const
+    {
+        const auto it = std::ranges::upper_bound(functions, rva, { }, &function_range::rva_begin);
+        if (it == functions.begin())
+            return nullptr;
+
+        const function_range& function = *std::prev(it);
+        return rva < function.rva_end ? &function : nullptr;
+    }
+
+    const function_range* function_index::find_entry(const uint32_t rva) const
+    {
+        const auto it = std::ranges::lower_bound(functions, rva, { }, &function_range::rva_begin);
+        if (it == functions.end() || it->rva_begin != rva)
+            return nullptr;
+
+        return &*it;
+    }
+
+    const std::vector<function_range>& function_index::get_functions() const
+    {
+        return functions;
+    }
+
+    std::vector<dasm::segment_dasm_ptr> function_index::explore(const std::vector<function_range>& ranges, util::thread_pool& pool) const
+    {
+        std::vector<std::future<dasm::segment_dasm_ptr>> jobs;
+        jobs.reserve(ranges.size());
+
+        for (const auto& [rva_begin, rva_end] : ranges)
+        {
+            jobs.push_back(pool.submit([this, rva_begin, rva_end]
+            {
+                uint8_t* buffer = image->rva_to_ptr<uint8_t>(rva_begin);
+
+                dasm::segment_dasm_ptr dasm = std::make_shared<dasm::segment_dasm>(rva_begin, buffer, rva_end - rva_begin);
+                dasm->explore_blocks(rva_begin);
+
+                return dasm;
+            }));
+        }
+
+        std::vector<dasm::segment_dasm_ptr> segments;
+        segments.reserve(ranges.size());
+
+        for (auto& job : jobs)
+            segments.push_back(job.get());
+
+        return segments;
+    }
+}
@@ -133,11 +133,8 @@ namespace eagle::pe
                     // calculate the offset within the section data
                     const uint32_t offset = va - section_start_va;
 
-                    // replace the bytes at the offset with 0x90
-                    std::generate_n(data.begin() + offset, bytes, [&]
-                    {
-                        return util::ran_device::get().gen_8();
-                    });
+                    // replace the bytes at the offset with random bytes
+                    util::ran_device::get().gen_bytes(data.data() + offset, bytes);
                 }
             }
 
@@ -1,7 +1,29 @@
 #include "eaglevm-core/util/random.h"
 
+#include <cstring>
+
 namespace eagle::util
 {
+    namespace
+    {
+        uint64_t splitmix64(uint64_t& x)
+        {
+            uint64_t z = x += 0x9E3779B97F4A7C15;
+            z = (z ^ z >> 30) * 0xBF58476D1CE4E5B9;
+            z = (z ^ z >> 27) * 0x94D049BB133111EB;
+            return z ^ z >> 31;
+        }
+
+        thread_local ran_device* current_device = nullptr;
+    }
+
+    void xoshiro256::seed(uint64_t value)
+    {
+        // state must never be all zero, splitmix64 guarantees that for any seed
+        for (uint64_t& s : state)
+            s = splitmix64(value);
+    }
+
     ran_device& get_ran_device()
     {
         return ran_device::get();
@@ -11,42 +33,70 @@ namespace eagle::util
     {
 #ifdef _DEBUG
         seed = 0xDEADBEEF;
-        gen.seed(0xDEADBEEF);
 #else
         std::random_device rd{};
-        seed = rd();
-        gen.seed(seed);
+        seed = static_cast<uint64_t>(rd()) << 32 | rd();
 #endif
+        gen.seed(seed);
+    }
+
+    ran_device::ran_device(const uint64_t stream_seed)
+    {
+        seed = stream_seed;
+        gen.seed(seed);
     }
 
     ran_device& ran_device::get()
     {
+        if (current_device)
+            return *current_device;
+
         static ran_device instance;
         return instance;
     }
 
+    ran_device ran_device::fork(const uint64_t stream_id) const
+    {
+        uint64_t mix = stream_id;
+        uint64_t stream_seed = seed ^ splitmix64(mix);
+        return ran_device(splitmix64(stream_seed));
+    }
+
     uint64_t ran_device::gen_64()
     {
-        std::uniform_int_distribution<std::mt19937::result_type> dist(0, UINT64_MAX);
-        return dist(gen);
+        return gen();
     }
 
     uint32_t ran_device::gen_32()
     {
-        std::uniform_int_distribution<std::mt19937::result_type> dist(0, UINT32_MAX);
-        return dist(gen);
+        // the upper bits of xoshiro256** are the strongest
+        return static_cast<uint32_t>(gen() >> 32);
     }
 
     uint16_t ran_device::gen_16()
     {
-        std::uniform_int_distribution<std::mt19937::result_type> dist(0, UINT16_MAX);
-        return dist(gen);
+        return static_cast<uint16_t>(gen() >> 48);
     }
 
     uint8_t ran_device::gen_8()
     {
-        std::uniform_int_distribution<std::mt19937::result_type> dist(0, UINT8_MAX);
-        return dist(gen);
+        return static_cast<uint8_t>(gen() >> 56);
+    }
+
+    void ran_device::gen_bytes(uint8_t* out, const size_t size)
+    {
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+        {
+            const uint64_t value = gen();
+            std::memcpy(out + i, &value, sizeof(uint64_t));
+        }
+
+        if (i < size)
+        {
+            const uint64_t value = gen();
+            std::memcpy(out + i, &value, size - i);
+        }
     }
 
     uint64_t ran_device::gen_dist(std::uniform_int_distribution<uint64_t>& distribution)
@@ -56,12 +106,24 @@ namespace eagle::util
 
     bool ran_device::gen_chance(const float chance)
     {
-        std::bernoulli_distribution dist(chance);
-        return dist(gen);
+        // 53 random bits mapped to [0, 1)
+        const double value = static_cast<double>(gen() >> 11) * 0x1.0p-53;
+        return value < chance;
     }
 
     double ran_device::gen_dist(std::uniform_real_distribution<>& distribution)
     {
         return distribution(gen);
     }
+
+    ran_stream::ran_stream(ran_device& device)
+    {
+        previous = current_device;
+        current_device = &device;
+    }
+
+    ran_stream::~ran_stream()
+    {
+        current_device = previous;
+    }
 }
@@ -0,0 +1,40 @@
+#include "eaglevm-core/util/region_arena.h"
+
+namespace eagle::util
+{
+    namespace
+    {
+        thread_local region_arena_ptr current_arena = nullptr;
+    }
+
+    region_arena::region_arena(const size_t initial_size)
+        : buffer(initial_size)
+    {
+    }
+
+    region_arena_ptr region_arena::create(const size_t initial_size)
+    {
+        return std::make_shared<region_arena>(initial_size);
+    }
+
+    region_arena_ptr region_arena::current()
+    {
+        return current_arena;
+    }
+
+    void* region_arena::allocate(const size_t size, const size_t alignment)
+    {
+        return buffer.allocate(size, alignment);
+    }
+
+    arena_scope::arena_scope(const region_arena_ptr& arena)
+    {
+        previous = current_arena;
+        current_arena = arena;
+    }
+
+    arena_scope::~arena_scope()
+    {
+        current_arena = previous;
+    }
+}
@@ -1,5 +1,7 @@
 #include "eaglevm-core/virtual_machine/ir/block.h"
 
+#include <atomic>
+
 namespace eagle::ir
 {
     block_ir::iterator block_ir::begin()
@@ -182,7 +184,7 @@ namespace eagle::ir
 
     block_ir::block_ir(const block_state state, const uint32_t custom_block_id): exit_cmd(nullptr), ir_state(state)
     {
-        static uint32_t current_block_id = 0;
+        static std::atomic_uint32_t current_block_id = 0;
         if (custom_block_id == UINT32_MAX)
             block_id = current_block_id++;
         else
@@ -1,13 +1,15 @@
 #include "eaglevm-core/virtual_machine/ir/commands/base_command.h"
 
+#include <atomic>
+
 namespace eagle::ir
 {
     base_command::base_command(const command_type command, const bool force_inline): type(command), force_inline(force_inline)
     {
-        static uint32_t id = 0;
+        static std::atomic_uint32_t id = 0;
 
-        unique_id = id;
-        unique_id_string = cmd_type_to_string(command) + ": " + std::to_string(id++);
+        unique_id = id.fetch_add(1);
+        unique_id_string = cmd_type_to_string(command) + ": " + std::to_string(unique_id);
     }
 
     command_type base_command::get_command_type() const
@@ -0,0 +1,20 @@
+#include "eaglevm-core/virtual_machine/ir/commands/cmd_vm_enter.h"
+
+namespace eagle::ir
+{
+    cmd_vm_enter::cmd_vm_enter(const std::optional<dasm::analysis::liveness_info>& live)
+        : base_command(command_type::vm_enter), live(live)
+    {
+    }
+
+    bool cmd_vm_enter::is_similar(const std::shared_ptr<base_command>& other)
+    {
+        const auto cmd = std::static_pointer_cast<cmd_vm_enter>(other);
+        return base_command::is_similar(other) && cmd->get_live() == live;
+    }
+
+    const std::optional<dasm::analysis::liveness_info>& cmd_vm_enter::get_live() const
+    {
+        return live;
+    }
+}
@@ -3,8 +3,8 @@
 
 namespace eagle::ir
 {
-    cmd_vm_exit::cmd_vm_exit(const ir_exit_result& result)
-        : base_command(command_type::vm_exit)
+    cmd_vm_exit::cmd_vm_exit(const ir_exit_result& result, const std::optional<dasm::analysis::liveness_info>& live)
+        : base_command(command_type::vm_exit), live(live)
     {
         branches.push_back(result);
     }
@@ -15,7 +15,7 @@ namespace eagle::ir
     bool cmd_vm_exit::is_similar(const std::shared_ptr<base_command>& other)
     {
         const auto cmd = std::static_pointer_cast<cmd_vm_exit>(other);
-        return base_command::is_similar(other) && branches[0].index() == cmd->branches[0].index() &&
+        return base_command::is_similar(other) && cmd->get_live() == live && branches[0].index() == cmd->branches[0].index() &&
             std::visit(overloaded{
                 [](const uint64_t a, const uint64_t b) { return a == b; },
                 [](const block_ptr& a, const block_ptr& b) { return a == b; },
@@ -28,6 +28,11 @@ namespace eagle::ir
         return branches.front();
     }
 
+    const std::optional<dasm::analysis::liveness_info>& cmd_vm_exit::get_live() const
+    {
+        return live;
+    }
+
     std::string cmd_vm_exit::to_string()
     {
         std::string out;
@@ -16,10 +16,37 @@
 
 namespace eagle::ir
 {
-    ir_translator::ir_translator(const dasm::segment_dasm_ptr& seg_dasm, dasm::analysis::liveness* liveness)
+    namespace
+    {
+        using liveness_span = std::span<const std::pair<dasm::analysis::liveness_info, dasm::analysis::liveness_info>>;
+
+        /*
+         * number of registers a vm transition in front of instruction i has to carry across
+         */
+        uint32_t get_carried_registers(const liveness_span liveness, const size_t i)
+        {
+            // without liveness every gpr but rsp, every xmm and rflags are carried
+            if (liveness.empty())
+                return 15 + 16 + 1;
+
+            const dasm::analysis::liveness_info& live = liveness[i].first;
+
+            uint32_t carried = live.get_flags() != 0;
+            for (int reg = codec::rax; reg <= codec::r15; reg++)
+                carried += reg != codec::rsp && live.get_gpr64(static_cast<codec::reg>(reg)) != 0;
+
+            for (int reg = codec::zmm0; reg <= codec::zmm15; reg++)
+                carried += live.get_zmm512(static_cast<codec::reg>(reg)) != 0;
+
+            return carried;
+        }
+    }
+
+    ir_translator::ir_translator(const dasm::segment_dasm_ptr& seg_dasm, dasm::analysis::liveness* liveness, const settings_ptr& settings_info)
     {
         dasm = std::move(seg_dasm);
         dasm_liveness = liveness;
+        settings = settings_info ? settings_info : std::make_shared<ir::settings>();
     }
 
     std::vector<preopt_block_ptr> ir_translator::translate()
@@ -50,53 +77,40 @@ namespace eagle::ir
         block_ptr current_block = nullptr;
         const block_ptr& exit = block_info->tail;
 
+        liveness_span liveness;
+        if (dasm_liveness) liveness = dasm_liveness->analyze_block(bb);
+
+        const std::vector<bool> native_runs = find_native_runs(bb, liveness);
+
+        // registers live going into instruction i, transitions only have to carry these across
+        auto live_in = [&](const size_t i) -> std::optional<dasm::analysis::liveness_info>
+        {
+            if (liveness.empty())
+                return std::nullopt;
+
+            return liveness[i].first;
+        };
+
         //
         // entry
         //
-        entry->push_back(std::make_shared<cmd_vm_enter>());
+        entry->push_back(std::make_shared<cmd_vm_enter>(live_in(0)));
 
         //
         // body
         //
 
-        std::vector<std::pair<dasm::analysis::liveness_info, dasm::analysis::liveness_info>> liveness;
-        if (dasm_liveness) liveness = dasm_liveness->analyze_block(bb);
-
         for (uint32_t i = 0; i < bb->decoded_insts.size(); i++)
         {
             // use il x86 translator to translate the instruction to il
             auto decoded_inst = bb->decoded_insts[i];
-            auto& [inst, ops] = decoded_inst;
-
-            constexpr std::array ignored_mnemonics = { codec::m_nop };
-            if (std::ranges::find(ignored_mnemonics, static_cast<codec::mnemonic>(inst.mnemonic)) != ignored_mnemonics.end())
+            if (is_ignored(decoded_inst))
                 continue;
 
-            handler::base_handler_gen_ptr handler_gen = nullptr;
-            std::optional<uint64_t> target_handler = std::nullopt;
+            const codec::mnemonic mnemonic = get_handler_mnemonic(static_cast<codec::mnemonic>(decoded_inst.instruction.mnemonic));
 
-            codec::mnemonic mnemonic = static_cast<codec::mnemonic>(inst.mnemonic);
-
-            // prepare the mnemonic incase its a conditional jump so that we can select the correct handler
-            // there will be a cleaner way of doing this but the default jcc instruction handler is located under the
-            // codec::m_jmp mnemonic which will be the way we select it here
-            if (is_jmp_or_jcc(mnemonic))
-                mnemonic = codec::m_jmp;
-
-            if (instruction_handlers.contains(mnemonic))
-            {
-                // first we verify if there is even a valid handler for this inustruction
-                // we do this by checking the handler generator for this specific handler
-                std::vector<handler_op> il_operands;
-                for (int j = 0; j < inst.operand_count_visible; j++)
-                {
-                    auto op = ops[j];
-                    il_operands.emplace_back(static_cast<codec::op_type>(op.type), static_cast<codec::reg_size>(op.size));
-                }
-
-                handler_gen = instruction_handlers[mnemonic];
-                target_handler = handler_gen->get_handler_id(il_operands);
-            }
+            // instructions inside of a native run are treated exactly like the ones without a handler
+            const std::optional<uint64_t> target_handler = native_runs[i] ? std::nullopt : get_target_handler(decoded_inst);
 
             bool translate_success = target_handler != std::nullopt;
             if (target_handler)
@@ -112,7 +126,7 @@ namespace eagle::ir
 
                 if (dasm_liveness)
                 {
-                    auto out_liveness = std::get<1>(liveness[i]);
+                    const auto& out_liveness = liveness[i].second;
                     auto inst_flags_liveness = dasm::analysis::liveness::compute_inst_flags(decoded_inst);
 
                     auto relevant_out = inst_flags_liveness & out_liveness;
@@ -150,7 +164,7 @@ namespace eagle::ir
                         block_info->body.push_back(current_block);
 
                         current_block = std::make_shared<block_virt_ir>();
-                        current_block->push_back(std::make_shared<cmd_vm_enter>());
+                        current_block->push_back(std::make_shared<cmd_vm_enter>(live_in(i)));
 
                         previous->push_back(std::make_shared<cmd_branch>(current_block));
                         previous->back()->get<cmd_branch>()->set_virtual(false);
@@ -165,7 +179,7 @@ namespace eagle::ir
                 if (current_block == nullptr)
                 {
                     current_block = std::make_shared<block_x86_ir>();
-                    entry->push_back(std::make_shared<cmd_vm_exit>(current_block));
+                    entry->push_back(std::make_shared<cmd_vm_exit>(current_block, live_in(i)));
                 }
 
                 if (current_block->get_block_state() == vm_block)
@@ -175,7 +189,7 @@ namespace eagle::ir
                     block_info->body.push_back(current_block);
 
                     current_block = std::make_shared<block_x86_ir>();
-                    previous->push_back(std::make_shared<cmd_vm_exit>(current_block));
+                    previous->push_back(std::make_shared<cmd_vm_exit>(current_block, live_in(i)));
                 }
 
                 // handler does not exist
@@ -231,7 +245,14 @@ namespace eagle::ir
 
         // we want to jump to the exit block now
         if (current_block->get_block_state() == vm_block)
-            current_block->push_back(std::make_shared<cmd_vm_exit>(exit));
+        {
+            // a native jmp or jcc in the tail still reads its operands and flags after the exit
+            std::optional<dasm::analysis::liveness_info> exit_live = std::nullopt;
+            if (!liveness.empty())
+                exit_live = bb->get_end_reason() == dasm::block_end ? liveness.back().second : liveness.back().first;
+
+            current_block->push_back(std::make_shared<cmd_vm_exit>(exit, exit_live));
+        }
         else
             current_block->push_back(std::make_shared<cmd_branch>(exit));
 
@@ -247,6 +268,81 @@ namespace eagle::ir
         return block_info;
     }
 
+    std::vector<bool> ir_translator::find_native_runs(const dasm::basic_block_ptr& bb, const liveness_span liveness) const
+    {
+        std::vector<bool> native_runs(bb->decoded_insts.size());
+        if (settings->native_run_threshold == 0)
+            return native_runs;
+
+        // supported instructions seen since the last unsupported one
+        std::vector<uint32_t> run;
+        bool after_unsupported = false;
+
+        for (uint32_t i = 0; i < bb->decoded_insts.size(); i++)
+        {
+            const codec::dec::inst_info& decoded_inst = bb->decoded_insts[i];
+            if (is_ignored(decoded_inst))
+                continue;
+
+            if (get_target_handler(decoded_inst))
+            {
+                run.push_back(i);
+                continue;
+            }
+
+            // virtualizing the run costs a vm enter in front of it and a vm exit behind it
+            if (after_unsupported && !run.empty() && run.size() <= settings->native_run_threshold)
+            {
+                const uint32_t transition_cost = get_carried_registers(liveness, run.front()) + get_carried_registers(liveness, i);
+                if (run.size() < transition_cost)
+                    for (const uint32_t idx : run)
+                        native_runs[idx] = true;
+            }
+
+            run.clear();
+            after_unsupported = true;
+        }
+
+        return native_runs;
+    }
+
+    bool ir_translator::is_ignored(const codec::dec::inst_info& decoded_inst)
+    {
+        constexpr std::array ignored_mnemonics = { codec::m_nop };
+        return std::ranges::contains(ignored_mnemonics, static_cast<codec::mnemonic>(decoded_inst.instruction.mnemonic));
+    }
+
+    codec::mnemonic ir_translator::get_handler_mnemonic(const codec::mnemonic mnemonic)
+    {
+        // prepare the mnemonic incase its a conditional jump so that we can select the correct handler
+        // there will be a cleaner way of doing this but the default jcc instruction handler is located under the
+        // codec::m_jmp mnemonic which will be the way we select it here
+        if (is_jmp_or_jcc(mnemonic))
+            return codec::m_jmp;
+
+        return mnemonic;
+    }
+
+    std::optional<uint64_t> ir_translator::get_target_handler(const codec::dec::inst_info& decoded_inst)
+    {
+        const auto& [inst, ops] = decoded_inst;
+
+        const codec::mnemonic mnemonic = get_handler_mnemonic(static_cast<codec::mnemonic>(inst.mnemonic));
+        if (!instruction_handlers.contains(mnemonic))
+            return std::nullopt;
+
+        // first we verify if there is even a valid handler for this inustruction
+        // we do this by checking the handler generator for this specific handler
+        std::vector<handler_op> il_operands;
+        for (int j = 0; j < inst.operand_count_visible; j++)
+        {
+            auto op = ops[j];
+            il_operands.emplace_back(static_cast<codec::op_type>(op.type), static_cast<codec::reg_size>(op.size));
+        }
+
+        return instruction_handlers[mnemonic]->get_handler_id(il_operands);
+    }
+
     std::vector<flat_block_vmid> ir_translator::flatten(std::unordered_map<preopt_block_ptr, uint32_t>& block_vm_ids,
         std::unordered_map<preopt_block_ptr, block_ptr>& block_tracker)
     {
@@ -294,7 +390,8 @@ namespace eagle::ir
         // every reference to the head is then rewritten to be the first body
         optimize_heads(block_vm_ids, block_tracker, extern_call_blocks);
         optimize_body_to_tail(block_vm_ids, block_tracker, extern_call_blocks);
-        optimize_same_vm(block_vm_ids, block_tracker, extern_call_blocks);
+        if (settings->optimize_same_vm)
+            optimize_same_vm(block_vm_ids, block_tracker, extern_call_blocks);
 
         return flatten(block_vm_ids, block_tracker);
     }
@@ -371,109 +468,92 @@ namespace eagle::ir
         std::unordered_map<preopt_block_ptr, block_ptr>& block_tracker,
         const std::vector<preopt_block_ptr>& extern_call_blocks)
     {
-        // // remove vm enter block if every reference to vm enter block uses the same vm
-        // for (const auto& [preopt_block, vm_id] : block_vm_ids)
-        // {
-        //     const block_ptr search_enter = preopt_block->head;
-        //     if (search_enter == nullptr)
-        //     {
-        //         // this means we removed the head
-        //         // meaning the first body block doesnt use vm enter
-        //         continue;
-        //     }
-        //
-        //     const block_ptr redirect_body = preopt_block->body.front();
-        //
-        //     bool vm_enter_unremovable = false;
-        //     std::vector<cmd_branch_ptr> search_enter_refs;
-        //
-        //     // check if there are any external calls to any of the body blocks
-        //     // if there are, we cannot remove vm enter
-        //     for (auto& external : extern_call_blocks)
-        //     {
-        //         if (preopt_block == external)
-        //         {
-        //             vm_enter_unremovable = true;
-        //             goto UNREMOVABLE;
-        //         }
-        //     }
-        //
-        //     // go through each preopt block
-        //     for (const auto& [search_preopt_block, search_vm_id] : block_vm_ids)
-        //     {
-        //         // go through each block
-        //         // the only blocks that can reference our search block are exits
-        //         const auto& search_block = search_preopt_block->tail;
-        //
-        //         const cmd_branch_ptr branch = search_block->exit_as_branch();
-        //         if (branch->branch_visits(search_enter))
-        //         {
-        //             if (search_vm_id != vm_id)
-        //                 vm_enter_unremovable = true;
-        //             else
-        //                 search_enter_refs.emplace_back(branch);
-        //         }
-        //
-        //         // the only case where this happens is if a block referencing the current search block
-        //         // is using a different vm id
-        //         if (vm_enter_unremovable)
-        //             goto UNREMOVABLE;
-        //     }
-        //
-        // UNREMOVABLE:
-        //     if (!vm_enter_unremovable)
-        //     {
-        //         // we found that we can replace each branch to the block with a branch to the body
-        //         for (const auto& branch_ref : search_enter_refs)
-        //             branch_ref->rewrite_branch(search_enter, redirect_body);
-        //
-        //         preopt_block->head = nullptr;
-        //
-        //         // TODO: make sure we are using a VIRTUAL branch for these branches
-        //         // this means a vmenter has to be added before any of these branches are called
-        //         // also check if
-        //     }
-        // }
-        //
-        // // remove vm exit block if every branching block uses the same vm
-        // for (const auto& [preopt_block, vm_id] : block_vm_ids)
-        // {
-        //     // check entery of every block
-        //     const block_ptr preopt_exit = preopt_block->tail;
-        //     const cmd_branch_ptr branch = preopt_exit->get_branch();
-        //
-        //     // now we want to check if the current vm group has all the exits of this preopt
-        //     auto is_same_vm = [&](const ir_exit_result& exit_result)
-        //     {
-        //         if (std::holds_alternative<block_ptr>(exit_result))
-        //         {
-        //             const block_ptr exit_block = std::get<block_ptr>(exit_result);
-        //             for (const auto& [search_preopt_block, search_vm_id] : block_vm_ids)
-        //             {
-        //                 const bool contains = search_preopt_block->head == exit_block || search_preopt_block->tail == exit_block ||
-        //                     std::ranges::find(search_preopt_block->body, exit_block) != search_preopt_block->body.end();
-        //
-        //                 if (contains)
-        //                     return search_vm_id == vm_id;
-        //             }
-        //         }
-        //
-        //         // if one of the exits is an rva then we have to exit no matter what : (
-        //         // otherwise the search would fall through to this fail
-        //         return false;
-        //     };
-        //
-        //     if (is_same_vm(branch->get_condition_default()) && is_same_vm(branch->get_condition_special()))
-        //     {
-        //         // this means all exits are of the same vm
-        //         const size_t command_count = preopt_exit->size();
-        //         VM_ASSERT(command_count <= 2 && command_count > 0, "preoptimized exit should not have more than 2 obfuscation");
-        //
-        //         // this means we should have a vm exit command
-        //         if (command_count == 2)
-        //             preopt_exit->erase(preopt_exit->begin());
-        //     }
-        // }
+        same_vm_stats = { };
+
+        // a head that is only vm enter followed by a virtual branch into its first body can be skipped
+        // by any block that is already running inside of the same vm
+        std::unordered_map<block_ptr, std::pair<preopt_block_ptr, block_ptr>> virtual_entries;
+        for (const auto& preopt : block_vm_ids | std::views::keys)
+        {
+            const auto head = preopt->head;
+            if (!head || head->size() != 2)
+                continue;
+
+            const cmd_branch_ptr enter_branch = head->exit_as_branch();
+            if (!enter_branch)
+                continue;
+
+            virtual_entries[head] = { preopt, std::get<block_ptr>(enter_branch->get_condition_default()) };
+        }
+
+        // if every exit of a preopt block lands in a head of the same vm, the vm exit and the native tail branch
+        // are replaced by a virtual branch that goes straight to the bodies behind those heads
+        for (const auto& [preopt, vm_id] : block_vm_ids)
+        {
+            const auto tail = preopt->tail;
+            if (!tail)
+                continue;
+
+            const block_ptr last_body = preopt->body.back();
+            if (last_body->get_block_state() != vm_block || !last_body->as_virt()->exit_as_vmexit())
+                continue;
+
+            const cmd_branch_ptr tail_branch = tail->exit_as_branch();
+            VM_ASSERT(tail_branch, "tail branch cannot be null");
+
+            const std::vector<ir_exit_result> targets = tail_branch->get_branches();
+            const bool same_vm = std::ranges::all_of(targets, [&](const ir_exit_result& target)
+            {
+                if (!std::holds_alternative<block_ptr>(target))
+                    return false;
+
+                const auto it = virtual_entries.find(std::get<block_ptr>(target));
+                return it != virtual_entries.end() && block_vm_ids.at(it->second.first) == vm_id;
+            });
+
+            if (!same_vm)
+                continue;
+
+            const auto branch = std::static_pointer_cast<cmd_branch>(tail_branch->clone());
+            for (const ir_exit_result& target : targets)
+            {
+                const block_ptr head = std::get<block_ptr>(target);
+                branch->rewrite_branch(head, virtual_entries[head].second);
+            }
+
+            branch->set_virtual(true);
+
+            last_body->pop_back();
+            last_body->push_back(branch);
+            preopt->tail = nullptr;
+
+            same_vm_stats.virtual_edges += targets.size();
+            same_vm_stats.removed_exits++;
+        }
+
+        // heads that nothing branches to natively anymore are dead
+        for (const auto& [head, entry] : virtual_entries)
+        {
+            const preopt_block_ptr& preopt = entry.first;
+            if (block_tracker.contains(preopt) || std::ranges::contains(extern_call_blocks, preopt))
+                continue;
+
+            const bool referenced = std::ranges::any_of(block_vm_ids | std::views::keys, [&](const preopt_block_ptr& seek_preopt)
+            {
+                return seek_preopt->tail && seek_preopt->tail->exit_as_branch()->branch_visits(head);
+            });
+
+            if (referenced)
+                continue;
+
+            preopt->head = nullptr;
+            same_vm_stats.removed_enters++;
+        }
+    }
+
+    transition_stats ir_translator::get_transition_stats() const
+    {
+        return same_vm_stats;
     }
 
     dasm::basic_block_ptr ir_translator::map_basic_block(const preopt_block_ptr& preopt_target)
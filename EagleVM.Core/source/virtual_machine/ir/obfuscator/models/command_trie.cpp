@@ -1,5 +1,6 @@
 #include "eaglevm-core/virtual_machine/ir/obfuscator/models/command_trie.h"
 
+#include <atomic>
 #include <unordered_set>
 #include <deque>
 #include <ranges>
@@ -8,7 +9,7 @@ namespace eagle::ir
 {
     trie_node_t::trie_node_t(const size_t depth): depth(depth), command(nullptr)
     {
-        static uint32_t id = 0;
+        static std::atomic_uint32_t id = 0;
         uuid = id++;
     }
 
@@ -12,8 +12,8 @@ namespace eagle::ir
     {
         for (const auto& preopt_block : preopt_vec)
         {
-            VM_ASSERT(liveness->live.contains(preopt_block->original_block), "liveness data must contain data for existing block");
-            const auto [block_in, block_out] = liveness->live.at(preopt_block->original_block);
+            VM_ASSERT(liveness->contains(preopt_block->original_block), "liveness data must contain data for existing block");
+            const auto& [block_in, block_out] = liveness->get_live(preopt_block->original_block);
 
             block_virt_ir_ptr first_block = nullptr;
             for (auto& body : preopt_block->body)
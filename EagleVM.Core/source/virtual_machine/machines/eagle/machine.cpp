@@ -3,6 +3,7 @@
 #include "eaglevm-core/virtual_machine/machines/eagle/register_manager.h"
 #include "eaglevm-core/virtual_machine/machines/eagle/settings.h"
 
+#include <map>
 #include <unordered_set>
 
 #include "eaglevm-core/virtual_machine/machines/util.h"
@@ -26,6 +27,95 @@ namespace eagle::virt::eg
     using namespace codec;
     using namespace codec::encoder;
 
+    namespace
+    {
+        using folded_label_map = std::unordered_map<asmb::code_label*, asmb::code_label_ptr>;
+
+        /*
+         * follows a label through every body it was folded into, labels that were never folded come back as they are
+         */
+        asmb::code_label_ptr resolve_label(const folded_label_map& folded_labels, asmb::code_label_ptr label)
+        {
+            for (auto it = folded_labels.find(label.get()); it != folded_labels.end(); it = folded_labels.find(label.get()))
+                label = it->second;
+
+            return label;
+        }
+
+        std::vector<asmb::code_label_ptr> get_placed_labels(const asmb::code_container_ptr& container)
+        {
+            std::vector<asmb::code_label_ptr> labels;
+            for (const inst_req_label_v& entry : container->get_instructions())
+                if (const asmb::code_label_ptr* label = std::get_if<asmb::code_label_ptr>(&entry))
+                    labels.push_back(*label);
+
+            return labels;
+        }
+
+        /*
+         * flattens a handler body into tokens where labels placed inside of the body are numbered in the order they are
+         * placed, two bodies with the same tokens encode to the same bytes wherever they end up in the section
+         *
+         * labels placed somewhere else are matched by the body they were folded into, so callers of two folded callees
+         * come out the same
+         */
+        std::vector<uint64_t> tokenize_body(const asmb::code_container_ptr& container, const folded_label_map& folded_labels)
+        {
+            const std::span<const inst_req_label_v> instructions = container->get_instructions();
+
+            std::unordered_map<asmb::code_label*, uint64_t> placed;
+            for (const inst_req_label_v& entry : instructions)
+                if (const asmb::code_label_ptr* label = std::get_if<asmb::code_label_ptr>(&entry))
+                    placed.try_emplace(label->get(), placed.size());
+
+            std::vector<uint64_t> tokens;
+            auto add = [&](const auto... values)
+            {
+                (tokens.push_back(static_cast<uint64_t>(values)), ...);
+            };
+
+            for (const inst_req_label_v& entry : instructions)
+            {
+                std::visit([&](auto&& arg)
+                {
+                    using T = std::decay_t<decltype(arg)>;
+                    if constexpr (std::is_same_v<T, inst_req>)
+                    {
+                        add(0, arg.mnemonic, arg.prefixes, arg.operands.size());
+                        for (const operand_v& op : arg.operands)
+                        {
+                            add(op.index());
+                            std::visit([&](auto&& operand)
+                            {
+                                using O = std::decay_t<decltype(operand)>;
+                                if constexpr (std::is_same_v<O, mem_op>)
+                                    add(operand.base, operand.index, operand.scale, operand.displacement, operand.read_size, operand.relative);
+                                else if constexpr (std::is_same_v<O, reg_op>)
+                                    add(operand.reg);
+                                else if constexpr (std::is_same_v<O, imm_op>)
+                                    add(operand.value, operand.relative);
+                                else if constexpr (std::is_same_v<O, imm_label_operand>)
+                                {
+                                    // labels placed somewhere else can only match by identity
+                                    if (const auto it = placed.find(operand.code_label.get()); it != placed.end())
+                                        add(0, it->second);
+                                    else
+                                        add(1, reinterpret_cast<uintptr_t>(resolve_label(folded_labels, operand.code_label).get()));
+
+                                    add(operand.relative, operand.negative);
+                                }
+                            }, op);
+                        }
+                    }
+                    else if constexpr (std::is_same_v<T, asmb::code_label_ptr>)
+                        add(1, placed[arg.get()]);
+                }, entry);
+            }
+
+            return tokens;
+        }
+    }
+
     machine::machine(const settings_ptr& settings_info)
     {
         settings = settings_info;
@@ -77,6 +167,7 @@ namespace eagle::virt::eg
         reg_64_container->reset();
         reg_128_container->reset();
 
+        lifted_blocks.push_back(code);
         return code;
     }
 
@@ -294,29 +385,58 @@ namespace eagle::virt::eg
     {
         const auto mnemonic = cmd->get_mnemonic();
 
-        std::vector<ir::base_command_ptr> generated_instructions;
+        // the generated body only depends on the mnemonic and the signature so every call site with the same pair shares one body
+        // the key holds all of it rather than a hash so a collision can never send a call into another handler
+        std::vector<uint64_t> call_key = { static_cast<uint64_t>(mnemonic), cmd->is_operand_sig() };
         if (cmd->is_operand_sig())
         {
-            const ir::x86_operand_sig sig = cmd->get_x86_signature();
-            generated_instructions = handler_manager::generate_handler(mnemonic, sig);
+            for (const auto& [operand_type, operand_size] : cmd->get_x86_signature())
+            {
+                call_key.push_back(operand_type);
+                call_key.push_back(operand_size);
+            }
         }
         else
         {
-            const ir::handler_sig sig = cmd->get_handler_signature();
-            generated_instructions = handler_manager::generate_handler(mnemonic, sig);
+            for (const ir::ir_size size : cmd->get_handler_signature())
+                call_key.push_back(static_cast<uint64_t>(size));
         }
 
-        const asmb::code_container_ptr container = asmb::code_container::create();
-        const auto target_label = asmb::code_label::create();
-        container->bind_start(target_label);
+        asmb::code_label_ptr target_label = nullptr;
+        if (const auto it = handler_call_labels.find(call_key); it != handler_call_labels.end())
+        {
+            target_label = it->second;
+            reused_calls++;
+        }
+        else
+        {
+            std::vector<ir::base_command_ptr> generated_instructions;
+            if (cmd->is_operand_sig())
+            {
+                const ir::x86_operand_sig sig = cmd->get_x86_signature();
+                generated_instructions = handler_manager::generate_handler(mnemonic, sig);
+            }
+            else
+            {
+                const ir::handler_sig sig = cmd->get_handler_signature();
+                generated_instructions = handler_manager::generate_handler(mnemonic, sig);
+            }
+
+            const asmb::code_container_ptr container = asmb::code_container::create();
+            target_label = asmb::code_label::create();
+            container->bind_start(target_label);
+
+            for (const ir::base_command_ptr& instruction : generated_instructions)
+                dispatch_handle_cmd(container, instruction);
 
-        for (const ir::base_command_ptr& instruction : generated_instructions)
-            dispatch_handle_cmd(container, instruction);
+            container->make(m_mov, reg_op(VCSRET), mem_op(VCS, 0, bit_64))
+                     .make(m_lea, reg_op(VCS), mem_op(VCS, 8, bit_64))
+                     .make(m_lea, reg_op(VIP), mem_op(VBASE, VCSRET, 1, 0, bit_64))
+                     .make(m_jmp, reg_op(VIP));
 
-        container->make(m_mov, reg_op(VCSRET), mem_op(VCS, 0, bit_64))
-                 .make(m_lea, reg_op(VCS), mem_op(VCS, 8, bit_64))
-                 .make(m_lea, reg_op(VIP), mem_op(VBASE, VCSRET, 1, 0, bit_64))
-                 .make(m_jmp, reg_op(VIP));
+            misc_handlers.emplace_back(target_label, container);
+            handler_call_labels[std::move(call_key)] = target_label;
+        }
 
         // write the call into the current block
         const asmb::code_label_ptr return_label = asmb::code_label::create();
@@ -335,8 +455,6 @@ namespace eagle::virt::eg
 
         // execution after VM handler should end up here
         out.label(return_label);
-
-        misc_handlers.emplace_back(target_label, container);
     }
 
     void machine::handle_cmd(const asmb::code_container_ptr& block, const ir::cmd_mem_read_ptr& cmd)
@@ -1040,7 +1158,156 @@ namespace eagle::virt::eg
         for (auto& [lable, dat] : misc_handlers)
             out.push_back(dat);
 
-        return out;
+        return sweep_handlers(fold_handlers(out));
+    }
+
+    std::vector<asmb::code_container_ptr> machine::sweep_handlers(const std::vector<asmb::code_container_ptr>& handlers)
+    {
+        std::unordered_map<asmb::code_label*, size_t> label_owner;
+        for (size_t i = 0; i < handlers.size(); i++)
+            for (const inst_req_label_v& entry : handlers[i]->get_instructions())
+                if (const asmb::code_label_ptr* label = std::get_if<asmb::code_label_ptr>(&entry))
+                    label_owner[label->get()] = i;
+
+        std::vector<bool> reachable(handlers.size(), false);
+        std::vector<asmb::code_container_ptr> worklist = lifted_blocks;
+        while (!worklist.empty())
+        {
+            const asmb::code_container_ptr container = worklist.back();
+            worklist.pop_back();
+
+            for (const inst_req_label_v& entry : container->get_instructions())
+            {
+                const inst_req* inst = std::get_if<inst_req>(&entry);
+                if (!inst)
+                    continue;
+
+                for (const asmb::code_label_ptr& dependent : inst->get_dependents())
+                {
+                    const auto it = label_owner.find(dependent.get());
+                    if (it == label_owner.end() || reachable[it->second])
+                        continue;
+
+                    reachable[it->second] = true;
+                    worklist.push_back(handlers[it->second]);
+                }
+            }
+        }
+
+        // whatever the sweep decides, nothing a lifted block calls may be dropped
+        for (const asmb::code_container_ptr& lifted : lifted_blocks)
+        {
+            for (const inst_req_label_v& entry : lifted->get_instructions())
+            {
+                const inst_req* inst = std::get_if<inst_req>(&entry);
+                if (!inst)
+                    continue;
+
+                for (const asmb::code_label_ptr& dependent : inst->get_dependents())
+                {
+                    const auto it = label_owner.find(dependent.get());
+                    VM_ASSERT(it == label_owner.end() || reachable[it->second], "sweep dropped a handler a lifted block calls");
+                }
+            }
+        }
+
+        std::vector<asmb::code_container_ptr> live;
+        for (size_t i = 0; i < handlers.size(); i++)
+        {
+            if (reachable[i])
+                live.push_back(handlers[i]);
+            else
+                dead_handlers++;
+        }
+
+        return live;
+    }
+
+    std::vector<asmb::code_container_ptr> machine::fold_handlers(const std::vector<asmb::code_container_ptr>& handlers)
+    {
+        // labels of folded bodies to their counterpart in the body they were folded into, in the order they were folded
+        folded_label_map folded_labels;
+        std::vector<asmb::code_label_ptr> folded_order;
+
+        // folding two callees can make their callers identical, so passes run until one of them folds nothing
+        std::vector<asmb::code_container_ptr> kept = handlers;
+        for (bool folded = true; folded;)
+        {
+            folded = false;
+
+            // bodies are only folded when their tokens match exactly, a hash collision can never merge two different handlers
+            std::map<std::vector<uint64_t>, asmb::code_container_ptr> bodies;
+            std::vector<asmb::code_container_ptr> next;
+            for (const asmb::code_container_ptr& handler : kept)
+            {
+                const auto [it, inserted] = bodies.try_emplace(tokenize_body(handler, folded_labels), handler);
+                if (inserted)
+                {
+                    next.push_back(handler);
+                    continue;
+                }
+
+                const std::vector<asmb::code_label_ptr> kept_labels = get_placed_labels(it->second);
+                const std::vector<asmb::code_label_ptr> handler_labels = get_placed_labels(handler);
+                for (size_t i = 0; i < handler_labels.size(); i++)
+                {
+                    folded_labels[handler_labels[i].get()] = kept_labels[i];
+                    folded_order.push_back(handler_labels[i]);
+                }
+
+                folded_handlers++;
+                folded = true;
+            }
+
+            kept = std::move(next);
+        }
+
+        // place the labels of every folded body next to their counterparts so call sites land in the kept body
+        std::unordered_map<asmb::code_label*, std::vector<asmb::code_label_ptr>> aliases;
+        for (const asmb::code_label_ptr& label : folded_order)
+            aliases[resolve_label(folded_labels, label).get()].push_back(label);
+
+        if (aliases.empty())
+            return kept;
+
+        for (const asmb::code_container_ptr& container : kept)
+        {
+            encode_builder& out = *container;
+            inst_list instructions = out.take_instructions();
+
+            for (inst_req_label_v& entry : instructions)
+            {
+                const asmb::code_label_ptr* label = std::get_if<asmb::code_label_ptr>(&entry);
+                const auto it = label ? aliases.find(label->get()) : aliases.end();
+
+                out.instruction_list.push_back(std::move(entry));
+                if (it == aliases.end())
+                    continue;
+
+                for (const asmb::code_label_ptr& alias : it->second)
+                    out.label(alias);
+            }
+        }
+
+        return kept;
+    }
+
+    handler_stats machine::get_handler_stats() const
+    {
+        handler_stats stats = { };
+        for (const auto& pairs : handler_map | std::views::values)
+        {
+            stats.handler_keys++;
+            stats.handler_variants += pairs.size();
+        }
+
+        stats.call_bodies = misc_handlers.size();
+        stats.reused_calls = reused_calls;
+        stats.reused_variants = reused_variants;
+        stats.folded_bodies = folded_handlers;
+        stats.dead_bodies = dead_handlers;
+
+        return stats;
     }
 
     reg machine::reg_vm_to_register(const ir::reg_vm store) const
@@ -1148,7 +1415,7 @@ namespace eagle::virt::eg
             {
             HANDLE_CREATE:
                 asmb::code_container_ptr builder = asmb::code_container::create();
-                target_label = asmb::code_label::create(std::to_string(handler_hash));
+                target_label = asmb::code_label::create(static_cast<uint64_t>(handler_hash));
 
                 builder->bind_start(target_label);
                 create(builder, reg_allocator);
@@ -1161,12 +1428,18 @@ namespace eagle::virt::eg
             }
             else
             {
-                constexpr float chance_to_generate = 0.3;
-                if (!(flags & force_unique) && (handler_map[handler_hash].empty() || util::get_ran_device().gen_chance(chance_to_generate)))
+                util::ran_device& device = util::get_ran_device();
+                const auto& handler_instances = handler_map[handler_hash];
+
+                // always roll so the stream advances the same way whether or not the pool is full
+                const bool generate = device.gen_chance(settings->chance_to_generate_x86_handler);
+                const bool pool_full = settings->max_handler_variants && handler_instances.size() >= settings->max_handler_variants;
+                if (handler_instances.empty() || (generate && !pool_full))
                     goto HANDLE_CREATE;
 
-                const auto& handler_instances = handler_map[handler_hash];
-                target_label = std::get<0>(util::get_ran_device().random_elem(handler_instances));
+                // pick by modulo rather than a distribution so the choice does not depend on the standard library
+                target_label = std::get<0>(handler_instances[device.gen_64() % handler_instances.size()]);
+                reused_variants++;
             }
 
             // write the call into the current block
@@ -3,6 +3,9 @@
 #include "eaglevm-core/virtual_machine/machines/eagle/register_manager.h"
 #include "eaglevm-core/virtual_machine/machines/eagle/settings.h"
 
+#include <algorithm>
+#include <deque>
+#include <span>
 #include <unordered_set>
 
 #include "eaglevm-core/virtual_machine/machines/util.h"
@@ -30,6 +33,249 @@ namespace eagle::virt::eg
     constexpr int32_t vm_stack_regs = 17 + 16 * 2;
     constexpr int32_t vm_call_stack = 3;
 
+    namespace
+    {
+        /*
+         * whether a transition has to carry the register across, without liveness every register is carried
+         * rsp never is since VSP stands in for it while virtualized
+         */
+        bool carries(const std::optional<dasm::analysis::liveness_info>& live, const reg target)
+        {
+            if (!live)
+                return true;
+
+            if (target == rsp)
+                return false;
+
+            if (get_reg_class(target) == xmm_128)
+                return live->get_zmm512(get_bit_version(target, zmm_512)) != 0;
+
+            return live->get_gpr64(target) != 0;
+        }
+
+        /*
+         * walks the commands and follows how many bytes VSP is below the entry rsp, peak records the deepest it gets
+         * @return false when VSP is moved by something that cannot be followed or goes deeper than limit
+         */
+        bool simulate_stack(const std::span<const ir::base_command_ptr> commands, int32_t& depth, int32_t& peak, const int32_t limit,
+            const uint32_t nesting = 0)
+        {
+            if (nesting > 8)
+                return false;
+
+            peak = std::max(peak, depth);
+            for (const ir::base_command_ptr& command : commands)
+            {
+                // bytes a command pushes and pops again before it is done
+                int32_t scratch = 0;
+
+                switch (command->get_command_type())
+                {
+                    case ir::command_type::vm_enter:
+                    {
+                        // VSP starts over at the entry rsp, the registers are scattered through a single slot
+                        depth = 0;
+                        scratch = 8;
+                        break;
+                    }
+                    case ir::command_type::vm_exit:
+                    {
+                        // registers are gathered through a single slot, then the exit is pushed and popped
+                        scratch = 8;
+                        break;
+                    }
+                    case ir::command_type::vm_handler_call:
+                    {
+                        const auto cmd = std::static_pointer_cast<ir::cmd_handler_call>(command);
+                        const std::vector<ir::base_command_ptr> handler = cmd->is_operand_sig()
+                            ? handler_manager::generate_handler(cmd->get_mnemonic(), cmd->get_x86_signature())
+                            : handler_manager::generate_handler(cmd->get_mnemonic(), cmd->get_handler_signature());
+
+                        if (!simulate_stack(handler, depth, peak, limit, nesting + 1))
+                            return false;
+                        break;
+                    }
+                    case ir::command_type::vm_call:
+                    {
+                        const ir::block_ptr target = std::static_pointer_cast<ir::cmd_call>(command)->get_target();
+                        if (!simulate_stack({ target->begin(), target->end() }, depth, peak, limit, nesting + 1))
+                            return false;
+                        break;
+                    }
+                    case ir::command_type::vm_push:
+                        depth += TOB(std::static_pointer_cast<ir::cmd_push>(command)->get_size());
+                        break;
+                    case ir::command_type::vm_pop:
+                        depth -= TOB(std::static_pointer_cast<ir::cmd_pop>(command)->get_size());
+                        break;
+                    case ir::command_type::vm_carry:
+                        depth += std::static_pointer_cast<ir::cmd_carry>(command)->get_move_size();
+                        break;
+                    case ir::command_type::vm_flags_load:
+                    case ir::command_type::vm_context_rflags_load:
+                        depth += 8;
+                        break;
+                    case ir::command_type::vm_context_rflags_store:
+                        scratch = 8;
+                        break;
+                    case ir::command_type::vm_mem_read:
+                        depth += TOB(std::static_pointer_cast<ir::cmd_mem_read>(command)->get_read_size()) - 8;
+                        break;
+                    case ir::command_type::vm_mem_write:
+                        depth -= TOB(std::static_pointer_cast<ir::cmd_mem_write>(command)->get_value_size()) + 8;
+                        break;
+                    case ir::command_type::vm_context_load:
+                    {
+                        const reg load_reg = std::static_pointer_cast<ir::cmd_context_load>(command)->get_reg();
+                        depth += get_reg_class(load_reg) == seg ? 8 : TOB(get_reg_size(load_reg));
+                        break;
+                    }
+                    case ir::command_type::vm_context_store:
+                    {
+                        // storing rsp points VSP at a computed value
+                        const reg store_reg = std::static_pointer_cast<ir::cmd_context_store>(command)->get_reg();
+                        if (get_bit_version(store_reg, bit_64) == rsp)
+                            return false;
+
+                        depth -= TOB(get_reg_size(store_reg));
+                        break;
+                    }
+                    case ir::command_type::vm_sx:
+                    {
+                        const auto cmd = std::static_pointer_cast<ir::cmd_sx>(command);
+                        depth += TOB(cmd->get_target()) - TOB(cmd->get_current());
+                        break;
+                    }
+                    case ir::command_type::vm_resize:
+                    {
+                        const auto cmd = std::static_pointer_cast<ir::cmd_resize>(command);
+                        depth += TOB(cmd->get_target()) - TOB(cmd->get_current());
+                        break;
+                    }
+                    case ir::command_type::vm_branch:
+                    {
+                        const auto cmd = std::static_pointer_cast<ir::cmd_branch>(command);
+                        if (!cmd->is_virtual())
+                            break;
+
+                        // virtual branches push their targets and let the inlined jcc handler pick one
+                        const ir::exit_condition condition = cmd->get_condition();
+                        depth += condition != ir::exit_condition::jmp ? 16 : 8;
+                        peak = std::max(peak, depth);
+
+                        const std::vector<ir::base_command_ptr> jcc = handler_manager::generate_handler(m_jmp, static_cast<uint64_t>(condition));
+                        if (!simulate_stack(jcc, depth, peak, limit, nesting + 1))
+                            return false;
+                        break;
+                    }
+                    case ir::command_type::vm_jmp:
+                        depth -= 8;
+                        break;
+                    case ir::command_type::vm_and:
+                    case ir::command_type::vm_or:
+                    case ir::command_type::vm_xor:
+                    case ir::command_type::vm_shl:
+                    case ir::command_type::vm_shr:
+                    case ir::command_type::vm_add:
+                    case ir::command_type::vm_sub:
+                    case ir::command_type::vm_smul:
+                    {
+                        // both operands are replaced by the result, or the result is pushed on top of them
+                        const auto cmd = std::static_pointer_cast<ir::cmd_add>(command);
+                        depth += cmd->get_preserved() ? TOB(cmd->get_size()) : -TOB(cmd->get_size());
+                        break;
+                    }
+                    case ir::command_type::vm_cnt:
+                    {
+                        const auto cmd = std::static_pointer_cast<ir::cmd_cnt>(command);
+                        depth += cmd->get_preserved() ? TOB(cmd->get_size()) : 0;
+                        break;
+                    }
+                    case ir::command_type::vm_abs:
+                    case ir::command_type::vm_log2:
+                    {
+                        const auto cmd = std::static_pointer_cast<ir::cmd_abs>(command);
+                        depth += cmd->get_preserved() ? TOB(cmd->get_size()) : 0;
+                        break;
+                    }
+                    case ir::command_type::vm_dup:
+                        depth += TOB(std::static_pointer_cast<ir::cmd_dup>(command)->get_size());
+                        break;
+                    case ir::command_type::vm_cmp:
+                        depth -= 2 * TOB(std::static_pointer_cast<ir::cmd_cmp>(command)->get_size());
+                        break;
+                    case ir::command_type::vm_exec_x86:
+                    case ir::command_type::vm_ret:
+                        break;
+                    default:
+                        return false;
+                }
+
+                peak = std::max({ peak, depth, depth + scratch });
+                if (peak > limit)
+                    return false;
+            }
+
+            return true;
+        }
+    }
+
+    uint32_t machine::reserve_stack(const std::vector<ir::block_ptr>& blocks)
+    {
+        // vm_exit stores VSP and the return address in the two slots below the guest stack
+        constexpr int32_t exit_slots = 16;
+        constexpr int32_t limit = 8 * vm_overhead - exit_slots;
+
+        // depth every vm block is entered at, virtual branches carry their depth into their targets
+        std::unordered_map<ir::block_ptr, int32_t> entry_depth;
+        std::deque<ir::block_ptr> worklist;
+        for (const ir::block_ptr& block : blocks)
+        {
+            if (block->get_block_state() != ir::vm_block)
+                continue;
+
+            entry_depth[block] = 0;
+            worklist.push_back(block);
+        }
+
+        int32_t peak = 0;
+        while (!worklist.empty())
+        {
+            const ir::block_ptr block = worklist.front();
+            worklist.pop_front();
+
+            int32_t depth = entry_depth[block];
+            if (!simulate_stack({ block->begin(), block->end() }, depth, peak, limit))
+            {
+                stack_reserve = vm_overhead;
+                return 8 * stack_reserve;
+            }
+
+            const ir::cmd_branch_ptr branch = block->as_virt()->exit_as_branch();
+            if (!branch)
+                continue;
+
+            for (const ir::ir_exit_result& target : branch->get_branches())
+            {
+                if (!std::holds_alternative<ir::block_ptr>(target))
+                    continue;
+
+                int32_t& target_depth = entry_depth[std::get<ir::block_ptr>(target)];
+                if (depth > target_depth)
+                {
+                    target_depth = depth;
+                    worklist.push_back(std::get<ir::block_ptr>(target));
+                }
+            }
+        }
+
+        // keep the reservation a multiple of 16 so it does not change the alignment of rsp
+        // the simulation is a separate copy of the VSP effect of every handler and nothing checks it against the lowered
+        // code yet, so it may only ever grow the fixed reservation and never shrink it
+        stack_reserve = std::max((peak + exit_slots + 15) / 16 * 2, vm_overhead);
+        return 8 * stack_reserve;
+    }
+
     void machine::handle_cmd(const asmb::code_container_ptr& block, const ir::cmd_vm_enter_ptr& cmd)
     {
         encode_builder& builder = *block;
@@ -39,17 +285,35 @@ namespace eagle::virt::eg
 
         // reserve VM call stack
         // reserve VM stack
-        builder.make(m_lea, reg_op(rsp), mem_op(rsp, -(8 * vm_overhead), TOB(bit_64)));
+        const int32_t reserve = stack_reserve ? stack_reserve : vm_overhead;
+        builder.make(m_lea, reg_op(rsp), mem_op(rsp, -(8 * reserve), TOB(bit_64)));
 
         // pushfq
+        // always pushed because the vm keeps the guest flags in this slot
         {
             builder.make(m_pushfq);
         }
 
         // push r0-r15 to stack
+        // dead registers only get their slot reserved, consecutive dead slots share a single lea
+        const std::optional<dasm::analysis::liveness_info>& live = cmd->get_live();
+
+        int32_t skipped = 0;
         regs->enumerate(
             [&](const reg reg)
             {
+                if (!carries(live, reg))
+                {
+                    skipped += get_reg_class(reg) == xmm_128 ? 16 : 8;
+                    return;
+                }
+
+                if (skipped)
+                {
+                    builder.make(m_lea, reg_op(rsp), mem_op(rsp, -skipped, TOB(bit_64)));
+                    skipped = 0;
+                }
+
                 if (get_reg_class(reg) == xmm_128)
                 {
                     builder.make(m_lea, reg_op(rsp), mem_op(rsp, -16, TOB(bit_64)))
@@ -58,6 +322,9 @@ namespace eagle::virt::eg
                 else builder.make(m_push, reg_op(reg));
             });
 
+        if (skipped)
+            builder.make(m_lea, reg_op(rsp), mem_op(rsp, -skipped, TOB(bit_64)));
+
         // mov VSP, rsp         ; begin virtualization by setting VSP to rsp
         // mov VREGS, VSP       ; set VREGS to currently pushed stack items
         // mov VCS, VSP         ; set VCALLSTACK to current stack top
@@ -91,7 +358,7 @@ namespace eagle::virt::eg
 
         // lea VTEMP, [VSP + (8 * (stack_regs + vm_overhead) + 1)] ; load the address of the original rsp (+1 because we pushed a rva)
         // mov VSP, VTEMP
-        builder.make(m_lea, reg_op(temp), mem_op(VSP, 8 * (vm_stack_regs + vm_overhead), bit_64))
+        builder.make(m_lea, reg_op(temp), mem_op(VSP, 8 * (vm_stack_regs + reserve), bit_64))
                .make(m_mov, reg_op(VSP), reg_op(temp));
 
         // setup register mappings
@@ -100,7 +367,7 @@ namespace eagle::virt::eg
 
         for (const reg& gpr : gprs)
         {
-            if (gpr == rsp)
+            if (gpr == rsp || !carries(live, gpr))
                 continue;
 
             auto [displacement, _] = regs->get_stack_displacement(gpr);
@@ -121,6 +388,7 @@ namespace eagle::virt::eg
     void machine::handle_cmd(const asmb::code_container_ptr& block, const ir::cmd_vm_exit_ptr& cmd)
     {
         encode_builder& builder = *block;
+        const std::optional<dasm::analysis::liveness_info>& live = cmd->get_live();
 
         // restore context
         std::array<reg, 16> gprs = register_manager::get_gpr64_regs();
@@ -129,6 +397,9 @@ namespace eagle::virt::eg
 
         for (const auto& gpr : gprs)
         {
+            if (!carries(live, gpr))
+                continue;
+
             auto [displacement, _] = regs->get_stack_displacement(gpr);
 
             scope_register_manager scope = reg_64_container->create_scope();
@@ -167,27 +438,45 @@ namespace eagle::virt::eg
         builder.make(m_mov, reg_op(rsp), reg_op(VREGS));
 
         //pop r0-r15 to stack
+        // rsp and dead registers are stepped over, consecutive skipped slots share a single lea
+        int32_t skipped = 0;
         regs->enumerate([&](auto reg)
         {
-            if (reg == ZYDIS_REGISTER_RSP)
+            if (reg == ZYDIS_REGISTER_RSP || !carries(live, reg))
             {
-                builder.make(m_lea, reg_op(rsp), mem_op(rsp, 8, bit_64));
+                skipped += get_reg_class(reg) == xmm_128 ? 16 : 8;
+                return;
             }
-            else
+
+            if (skipped)
             {
-                if (get_reg_class(reg) == xmm_128)
-                {
-                    builder.make(m_movdqu, reg_op(reg), mem_op(rsp, 0, bit_128))
-                           .make(m_lea, reg_op(rsp), mem_op(rsp, 16, bit_64));
-                }
-                else builder.make(m_pop, reg_op(reg));
+                builder.make(m_lea, reg_op(rsp), mem_op(rsp, skipped, bit_64));
+                skipped = 0;
             }
+
+            if (get_reg_class(reg) == xmm_128)
+            {
+                builder.make(m_movdqu, reg_op(reg), mem_op(rsp, 0, bit_128))
+                       .make(m_lea, reg_op(rsp), mem_op(rsp, 16, bit_64));
+            }
+            else builder.make(m_pop, reg_op(reg));
         }, true);
 
         // popfq
+        if (!live || live->get_flags() != 0)
         {
+            if (skipped)
+            {
+                builder.make(m_lea, reg_op(rsp), mem_op(rsp, skipped, bit_64));
+                skipped = 0;
+            }
+
             builder.make(m_popfq);
         }
+        else skipped += 8;
+
+        if (skipped)
+            builder.make(m_lea, reg_op(rsp), mem_op(rsp, skipped, bit_64));
 
         // the rsp that we set up earlier before popping all the regs
         builder.make(m_pop, reg_op(rsp))
@@ -6,6 +6,10 @@
 
 int main(int, char*[])
 {
+    // the nested loop keeps control going between the same few blocks, comparing the cycle count of a binary protected
+    // with and without --no-same-vm shows what the transitions between the vm and native code cost
+    const uint64_t begin_tsc = __rdtsc();
+
     fnEagleVMBegin();
 
     std::string some_output;
@@ -23,9 +27,13 @@ int main(int, char*[])
         std::reverse(some_output.begin(), some_output.end());
     }
 
+    const uint64_t end_tsc = __rdtsc();
+
     std::cout << some_output << std::endl;
     system("pause");
 
     fnEagleVMEnd();
+
+    std::printf("[>] virtualized loop took %llu cycles\n", end_tsc - begin_tsc);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+
+namespace encoder_test
+{
+    /**
+     * encodes every instruction form the machines emit with both the fast encoder and zydis and compares the results
+     * @return number of forms where the two disagree
+     */
+    uint32_t run_differential();
+}
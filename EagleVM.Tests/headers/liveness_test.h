@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+
+namespace liveness_test
+{
+    /**
+     * runs read modify write instructions through the liveness analysis and checks that everything they read is
+     * live going into them and going into their block
+     * @return number of registers and flags that were missing or live when they should be dead
+     */
+    uint32_t run_rmw();
+
+    /**
+     * writes a low register in front of reads of higher ones and checks that only the written register is dead
+     * @return number of registers that were live or dead when they should not have been
+     */
+    uint32_t run_def_before_use();
+
+    /**
+     * inserts every gpr on its own and checks that no other register is touched
+     * @return number of registers that had the wrong bytes set
+     */
+    uint32_t run_register_masks();
+}
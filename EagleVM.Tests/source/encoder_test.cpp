@@ -0,0 +1,285 @@
+#include "encoder_test.h"
+
+#include <cstring>
+#include <format>
+#include <string>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+
+#include "eaglevm-core/codec/fast_encoder.h"
+#include "eaglevm-core/codec/zydis_helper.h"
+
+using namespace eagle;
+
+namespace
+{
+    struct differential_stats
+    {
+        uint32_t identical = 0;
+        uint32_t equivalent = 0;
+        uint32_t fallback = 0;
+        uint32_t failed = 0;
+    };
+
+    std::string to_hex(const uint8_t* bytes, const size_t length)
+    {
+        std::string hex;
+        for (size_t i = 0; i < length; i++)
+            hex += std::format("{:02x}", bytes[i]);
+
+        return hex;
+    }
+
+    bool same_operand(const codec::dec::operand& first, const codec::dec::operand& second)
+    {
+        if (first.type != second.type || first.size != second.size)
+            return false;
+
+        switch (first.type)
+        {
+            case ZYDIS_OPERAND_TYPE_REGISTER:
+                return first.reg.value == second.reg.value;
+            case ZYDIS_OPERAND_TYPE_MEMORY:
+                return first.mem.base == second.mem.base &&
+                    first.mem.index == second.mem.index &&
+                    first.mem.scale == second.mem.scale &&
+                    first.mem.disp.value == second.mem.disp.value;
+            case ZYDIS_OPERAND_TYPE_IMMEDIATE:
+                return first.imm.value.u == second.imm.value.u && first.imm.is_relative == second.imm.is_relative;
+            default:
+                return false;
+        }
+    }
+
+    /*
+     * register to register forms have two opcodes that do the same thing, zydis and the fast encoder are free to pick
+     * either one, so anything that is not byte for byte identical is compared by what it decodes to
+     */
+    void check(codec::enc::req request, const uint64_t address, differential_stats& stats)
+    {
+        uint8_t fast[ZYDIS_MAX_INSTRUCTION_LENGTH];
+        const uint8_t fast_length = codec::fast_encode(request, address, fast);
+        if (fast_length == 0)
+        {
+            stats.fallback++;
+            return;
+        }
+
+        uint8_t zydis[ZYDIS_MAX_INSTRUCTION_LENGTH];
+        ZyanUSize zydis_length = ZYDIS_MAX_INSTRUCTION_LENGTH;
+        if (!ZYAN_SUCCESS(ZydisEncoderEncodeInstructionAbsolute(&request, zydis, &zydis_length, address)))
+        {
+            stats.failed++;
+            spdlog::get("console")->error("[encoder] zydis rejected {} which was fast encoded", to_hex(fast, fast_length));
+            return;
+        }
+
+        if (fast_length == zydis_length && std::memcmp(fast, zydis, fast_length) == 0)
+        {
+            stats.identical++;
+            return;
+        }
+
+        codec::dec::inst_info fast_decode{ };
+        codec::dec::inst_info zydis_decode{ };
+
+        const bool decoded =
+            ZYAN_SUCCESS(ZydisDecoderDecodeFull(&zyids_decoder, fast, fast_length, &fast_decode.instruction, fast_decode.operands)) &&
+            ZYAN_SUCCESS(ZydisDecoderDecodeFull(&zyids_decoder, zydis, zydis_length, &zydis_decode.instruction, zydis_decode.operands));
+
+        bool same = decoded &&
+            fast_length == zydis_length &&
+            fast_decode.instruction.length == fast_length &&
+            fast_decode.instruction.mnemonic == zydis_decode.instruction.mnemonic &&
+            fast_decode.instruction.operand_count_visible == zydis_decode.instruction.operand_count_visible;
+
+        for (uint8_t i = 0; same && i < fast_decode.instruction.operand_count_visible; i++)
+            same = same_operand(fast_decode.operands[i], zydis_decode.operands[i]);
+
+        if (same)
+        {
+            stats.equivalent++;
+            return;
+        }
+
+        stats.failed++;
+        spdlog::get("console")->error("[encoder] mismatch at {:x}, fast {} zydis {} ({})", address,
+            to_hex(fast, fast_length), to_hex(zydis, zydis_length),
+            decoded ? codec::instruction_to_string(zydis_decode) : "undecodable");
+    }
+
+    std::vector<codec::reg> get_gprs(const uint16_t size)
+    {
+        codec::reg first;
+        codec::reg last;
+        switch (size)
+        {
+            case 1: first = codec::al, last = codec::r15b;
+                break;
+            case 2: first = codec::ax, last = codec::r15w;
+                break;
+            case 4: first = codec::eax, last = codec::r15d;
+                break;
+            default: first = codec::rax, last = codec::r15;
+                break;
+        }
+
+        std::vector<codec::reg> regs;
+        for (int reg = first; reg <= last; reg++)
+            regs.push_back(static_cast<codec::reg>(reg));
+
+        return regs;
+    }
+
+    std::vector<codec::enc::op_mem> get_memory_operands(const uint16_t size)
+    {
+        constexpr int64_t displacements[] = { 0, 1, -1, 0x7F, 0x80, -0x80, -0x81, 0x12345, INT32_MIN, INT32_MAX };
+        constexpr codec::reg indexes[] = { codec::none, codec::rax, codec::rbp, codec::r12, codec::r13 };
+        constexpr uint8_t scales[] = { 1, 2, 4, 8 };
+
+        std::vector<codec::enc::op_mem> operands;
+        for (const codec::reg base : get_gprs(8))
+        {
+            for (const codec::reg index : indexes)
+            {
+                for (const uint8_t scale : scales)
+                {
+                    if (index == codec::none && scale != 1)
+                        continue;
+
+                    for (const int64_t displacement : displacements)
+                    {
+                        // zydis does not like 1 scale encoding without an index
+                        operands.push_back(index == codec::none
+                            ? ZMEMBD(base, displacement, size)
+                            : codec::enc::op_mem{ (ZydisRegister)base, (ZydisRegister)index, scale, displacement, size });
+                    }
+                }
+            }
+        }
+
+        return operands;
+    }
+}
+
+uint32_t encoder_test::run_differential()
+{
+    using namespace codec;
+
+    differential_stats stats;
+
+    constexpr uint64_t address = 0x1000;
+    constexpr int64_t immediates[] = {
+        0, 1, 2, 0x7F, 0x80, -1, -0x80, -0x81, 0xFF, 0x100, 0x7FFF, 0x8000, -0x8000, 0xFFFF,
+        INT32_MAX, INT32_MIN, 0x80000000, 0xFFFFFFFF, 0x123456789, -0x123456789
+    };
+
+    constexpr mnemonic binary_mnemonics[] = { m_mov, m_add, m_sub, m_or, m_and, m_xor };
+    constexpr uint16_t sizes[] = { 1, 2, 4, 8 };
+
+    for (const mnemonic mnemonic : binary_mnemonics)
+    {
+        for (const uint16_t size : sizes)
+        {
+            const std::vector<reg> regs = get_gprs(size);
+            for (const reg first : regs)
+            {
+                for (const reg second : regs)
+                    check(encode(mnemonic, ZREG(first), ZREG(second)), address, stats);
+
+                for (const int64_t imm : immediates)
+                    check(encode(mnemonic, ZREG(first), ZIMMS(imm)), address, stats);
+            }
+
+            const reg operand_regs[] = { regs[0], regs[4], regs[9], regs[15] };
+            for (const enc::op_mem& mem : get_memory_operands(size))
+            {
+                for (const reg operand_reg : operand_regs)
+                {
+                    check(encode(mnemonic, mem, ZREG(operand_reg)), address, stats);
+                    check(encode(mnemonic, ZREG(operand_reg), mem), address, stats);
+                }
+
+                for (const int64_t imm : { 0ll, 5ll, -3ll, 0x1234ll, 0x7FFFFFFFll })
+                    check(encode(mnemonic, mem, ZIMMS(imm)), address, stats);
+            }
+        }
+    }
+
+    for (const uint16_t size : { 2, 4, 8 })
+        for (const reg target : get_gprs(size))
+            for (const enc::op_mem& mem : get_memory_operands(8))
+                check(encode(m_lea, ZREG(target), mem), address, stats);
+
+    for (const mnemonic mnemonic : { m_shl, m_shr })
+    {
+        for (const uint16_t size : sizes)
+        {
+            for (const reg target : get_gprs(size))
+            {
+                for (const uint64_t count : { 1, 2, 7, 31, 63 })
+                    check(encode(mnemonic, ZREG(target), ZIMMU(count)), address, stats);
+
+                check(encode(mnemonic, ZREG(target), ZREG(cl)), address, stats);
+            }
+
+            for (const enc::op_mem& mem : get_memory_operands(size))
+                check(encode(mnemonic, mem, ZIMMU(3)), address, stats);
+        }
+    }
+
+    for (const reg gpr : get_gprs(8))
+    {
+        check(encode(m_push, ZREG(gpr)), address, stats);
+        check(encode(m_pop, ZREG(gpr)), address, stats);
+        check(encode(m_jmp, ZREG(gpr)), address, stats);
+
+        for (int xmm = xmm0; xmm <= xmm15; xmm++)
+        {
+            check(encode(m_movq, ZREG(xmm), ZREG(gpr)), address, stats);
+            check(encode(m_movq, ZREG(gpr), ZREG(xmm)), address, stats);
+            check(encode(m_pextrq, ZREG(gpr), ZREG(xmm), ZIMMU(1)), address, stats);
+            check(encode(m_pinsrq, ZREG(xmm), ZREG(gpr), ZIMMU(1)), address, stats);
+        }
+    }
+
+    for (const enc::op_mem& mem : get_memory_operands(8))
+        check(encode(m_jmp, mem), address, stats);
+
+    check(encode(m_pushfq), address, stats);
+    check(encode(m_popfq), address, stats);
+
+    // branch and rip relative targets are absolute, the distances straddle the rel8 boundary on both sides
+    constexpr mnemonic branch_mnemonics[] = {
+        m_jmp, m_jo, m_jno, m_jb, m_jnb, m_jz, m_jnz, m_jbe, m_jnbe, m_js, m_jns, m_jp, m_jnp, m_jl, m_jnl, m_jle, m_jnle
+    };
+
+    constexpr int64_t distances[] = { 0, 2, 127, 128, 129, 130, -126, -127, -128, -129, -130, 0x10000, -0x10000 };
+    for (const int64_t distance : distances)
+    {
+        const int64_t target = address + distance;
+        for (const mnemonic mnemonic : branch_mnemonics)
+        {
+            check(encode(mnemonic, ZIMMS(target)), address, stats);
+
+            enc::req near_branch = encode(mnemonic, ZIMMS(target));
+            near_branch.branch_width = ZYDIS_BRANCH_WIDTH_32;
+            check(near_branch, address, stats);
+        }
+
+        for (const uint16_t size : { 4, 8 })
+        {
+            const enc::op_mem rip_mem = ZMEMBD(rip, target, size);
+
+            check(encode(m_mov, ZREG(size == 4 ? r9d : r9), rip_mem), address, stats);
+            check(encode(m_mov, rip_mem, ZIMMS(7)), address, stats);
+            check(encode(m_lea, ZREG(rbx), rip_mem), address, stats);
+        }
+    }
+
+    spdlog::get("console")->info("[encoder] fast encoder matched zydis on {} forms, {} byte for byte, {} left to zydis",
+        stats.identical + stats.equivalent, stats.identical, stats.fallback);
+
+    return stats.failed;
+}
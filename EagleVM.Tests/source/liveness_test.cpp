@@ -0,0 +1,173 @@
+#include "liveness_test.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+
+#include "eaglevm-core/disassembler/dasm.h"
+#include "eaglevm-core/disassembler/analysis/liveness.h"
+
+using namespace eagle;
+
+namespace
+{
+    struct live_check
+    {
+        std::string where;
+        codec::reg reg;
+        uint64_t flags;
+
+        // an over approximation passes every live check, so the registers that have to be dead are checked as well
+        bool live = true;
+    };
+
+    uint32_t check(const dasm::analysis::liveness_info& live, const live_check& expected)
+    {
+        uint32_t failed = 0;
+        if (expected.reg != codec::none && !expected.live && live.get_gpr64(expected.reg))
+        {
+            failed++;
+            spdlog::get("console")->error("[liveness] {} is live going into {}", codec::reg_to_string(expected.reg), expected.where);
+        }
+
+        if (expected.reg != codec::none && expected.live && !live.get_gpr64(expected.reg))
+        {
+            failed++;
+            spdlog::get("console")->error("[liveness] {} is not live going into {}", codec::reg_to_string(expected.reg), expected.where);
+        }
+
+        if ((live.get_flags() & expected.flags) != expected.flags)
+        {
+            failed++;
+            spdlog::get("console")->error("[liveness] flags {:x} are not live going into {}", expected.flags, expected.where);
+        }
+
+        return failed;
+    }
+}
+
+uint32_t liveness_test::run_rmw()
+{
+    using namespace codec;
+
+    // add rax, 1
+    // adc rcx, rbx
+    // inc rdx
+    // mov r8, r9
+    // mov r9, 0
+    // ret
+    std::vector<uint8_t> code = {
+        0x48, 0x83, 0xC0, 0x01,
+        0x48, 0x11, 0xD9,
+        0x48, 0xFF, 0xC2,
+        0x4D, 0x89, 0xC8,
+        0x49, 0xC7, 0xC1, 0x00, 0x00, 0x00, 0x00,
+        0xC3
+    };
+
+    const dasm::segment_dasm_ptr dasm = std::make_shared<dasm::segment_dasm>(0, code.data(), code.size());
+    dasm->explore_blocks(0);
+
+    const dasm::basic_block_ptr block = dasm->get_block(0, false);
+
+    dasm::analysis::liveness live(dasm);
+    live.compute_blocks_use_def();
+    live.analyze_cross_liveness();
+
+    // every instruction here also writes what it reads, none of it may drop out of the use set
+    const auto block_liveness = live.analyze_block(block);
+
+    uint32_t failed = 0;
+    failed += check(block_liveness[0].first, { "add rax, 1", rax, 0 });
+    failed += check(block_liveness[1].first, { "adc rcx, rbx", rcx, ZYDIS_CPUFLAG_CF });
+    failed += check(block_liveness[1].first, { "adc rcx, rbx", rbx, 0 });
+    failed += check(block_liveness[2].first, { "inc rdx", rdx, 0 });
+    failed += check(block_liveness[4].first, { "mov r9, 0", r9, 0, false });
+
+    // r9 is read before the block overwrites it
+    const auto& [block_in, block_out] = live.get_live(block);
+    for (const reg reg : { rax, rbx, rcx, rdx, r9 })
+        failed += check(block_in, { "the block", reg, 0 });
+
+    if (!failed)
+        spdlog::get("console")->info("[liveness] read modify write instructions keep their operands live");
+
+    return failed;
+}
+
+uint32_t liveness_test::run_def_before_use()
+{
+    using namespace codec;
+
+    // mov rax, 1
+    // add rbx, rcx
+    // ret
+    std::vector<uint8_t> code = {
+        0x48, 0xC7, 0xC0, 0x01, 0x00, 0x00, 0x00,
+        0x48, 0x01, 0xCB,
+        0xC3
+    };
+
+    const dasm::segment_dasm_ptr dasm = std::make_shared<dasm::segment_dasm>(0, code.data(), code.size());
+    dasm->explore_blocks(0);
+
+    const dasm::basic_block_ptr block = dasm->get_block(0, false);
+
+    dasm::analysis::liveness live(dasm);
+    live.compute_blocks_use_def();
+    live.analyze_cross_liveness();
+
+    // the write to rax must not reach the registers after it, rbx and rcx are still read by the add
+    const auto& [block_in, block_out] = live.get_live(block);
+
+    uint32_t failed = 0;
+    failed += check(block_in, { "the block", rax, 0, false });
+    failed += check(block_in, { "the block", rbx, 0 });
+    failed += check(block_in, { "the block", rcx, 0 });
+
+    const auto block_liveness = live.analyze_block(block);
+    failed += check(block_liveness[1].first, { "add rbx, rcx", rax, 0, false });
+
+    if (!failed)
+        spdlog::get("console")->info("[liveness] a write only kills the register it writes");
+
+    return failed;
+}
+
+uint32_t liveness_test::run_register_masks()
+{
+    using namespace codec;
+
+    // a 64 bit register owns 8 bits and its 32 bit form the low 4, nothing may spill into the registers after it
+    uint32_t failed = 0;
+    for (int inserted = rax; inserted <= r15; inserted++)
+    {
+        const reg full = static_cast<reg>(inserted);
+        for (const reg_class size : { gpr_64, gpr_32 })
+        {
+            const reg sized = get_bit_version(full, size);
+
+            dasm::analysis::liveness_info info;
+            info.insert_register(sized);
+
+            for (int other = rax; other <= r15; other++)
+            {
+                const uint8_t expected = other != inserted ? 0 : size == gpr_64 ? 0xFF : 0x0F;
+                const uint8_t result = info.get_gpr64(static_cast<reg>(other));
+                if (result == expected)
+                    continue;
+
+                failed++;
+                spdlog::get("console")->error("[liveness] inserting {} set {:02x} on {}, expected {:02x}",
+                    reg_to_string(sized), result, reg_to_string(static_cast<reg>(other)), expected);
+            }
+        }
+    }
+
+    if (!failed)
+        spdlog::get("console")->info("[liveness] registers only ever set their own bytes");
+
+    return failed;
+}
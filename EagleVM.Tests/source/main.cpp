@@ -11,6 +11,7 @@
 #include <future>
 #include <vector>
 #include <eaglevm-core/disassembler/dasm.h>
+#include <eaglevm-core/disassembler/analysis/liveness.h>
 
 #include "nlohmann/json.hpp"
 
@@ -21,6 +22,8 @@
 
 #include "util.h"
 #include "run_container.h"
+#include "encoder_test.h"
+#include "liveness_test.h"
 #include "eaglevm-core/compiler/section_manager.h"
 #include "eaglevm-core/virtual_machine/ir/ir_translator.h"
 #include "eaglevm-core/virtual_machine/machines/eagle/machine.h"
@@ -54,14 +57,36 @@ const std::string inclusive_tests[] = {
     "shr",
 };
 
+// the test data never leaves the vm in the middle of a block, these exit in front of a native instruction that reads
+// state the vm just wrote, or enter in front of a write that comes before reads of other registers, so they only pass
+// if the liveness the transitions use keeps that state
+const char* partial_exit_tests = R"([
+    {
+        "instr": "add rax, rbx; adc rax, rbx",
+        "data": "4801d84811d8",
+        "inputs": { "rax": "ffffffffffffffff", "rbx": "0100000000000000" },
+        "outputs": { "rax": "0200000000000000", "rbx": "0100000000000000" }
+    },
+    {
+        "instr": "mov rax, 1; add rbx, rcx",
+        "data": "48c7c0010000004801cb",
+        "inputs": { "rbx": "0200000000000000", "rcx": "0300000000000000" },
+        "outputs": { "rax": "0100000000000000", "rbx": "0500000000000000", "rcx": "0300000000000000" }
+    }
+])";
+
 using namespace eagle;
 
 std::atomic_uint32_t total_passed = 0;
 std::atomic_uint32_t total_failed = 0;
 
 void process_entry(const virt::eg::settings_ptr& machine_settings, const nlohmann::basic_json<>& test, std::atomic_uint32_t* passed,
-    std::atomic_uint32_t* failed, uint32_t task_id)
+    std::atomic_uint32_t* failed, uint32_t task_id, bool use_liveness)
 {
+    // each test gets its own stream so results are reproducible under the parallel policy
+    util::ran_device task_device = util::get_ran_device().fork(task_id);
+    util::ran_stream task_stream(task_device);
+
     std::stringstream ss;
 
     // create a new file for each test
@@ -107,7 +132,16 @@ void process_entry(const virt::eg::settings_ptr& machine_settings, const nlohman
     dasm::segment_dasm_ptr dasm = std::make_shared<dasm::segment_dasm>(0, instruction_data.data(), instruction_data.size());
     dasm->explore_blocks(0);
 
-    std::shared_ptr<ir::ir_translator> ir_trans = std::make_shared<ir::ir_translator>(dasm);
+    // without liveness every transition saves and restores everything
+    std::unique_ptr<dasm::analysis::liveness> seg_live = nullptr;
+    if (use_liveness)
+    {
+        seg_live = std::make_unique<dasm::analysis::liveness>(dasm);
+        seg_live->compute_blocks_use_def();
+        seg_live->analyze_cross_liveness();
+    }
+
+    std::shared_ptr<ir::ir_translator> ir_trans = std::make_shared<ir::ir_translator>(dasm, seg_live.get());
     ir::preopt_block_vec preopt = ir_trans->translate();
 
     // here we assign vms to each block
@@ -151,6 +185,9 @@ void process_entry(const virt::eg::settings_ptr& machine_settings, const nlohman
 
         machine->add_block_context(block_labels);
 
+        // every test runs with the computed reservation, a virtual stack that outgrows it overwrites the saved context
+        machine->reserve_stack(blocks);
+
         for (auto i = 0; i < blocks.size(); i++)
         {
             auto& translated_block = blocks[i];
@@ -284,6 +321,18 @@ int main(int argc, char* argv[])
     auto console_logger = spdlog::stdout_color_mt("console");
     spdlog::flush_every(std::chrono::seconds(5));
 
+    // every handler goes through the fast encoder, make sure it still agrees with zydis before running anything
+    const uint32_t encoder_failures = encoder_test::run_differential();
+    if (encoder_failures)
+        spdlog::get("console")->error("[encoder] fast encoder disagreed with zydis on {} forms", encoder_failures);
+
+    total_failed += encoder_failures;
+
+    // transitions only carry what the liveness analysis says is live, anything missing here is a miscompile
+    total_failed += liveness_test::run_register_masks();
+    total_failed += liveness_test::run_rmw();
+    total_failed += liveness_test::run_def_before_use();
+
     virt::eg::settings_ptr machine_settings = std::make_shared<virt::eg::settings>();
     machine_settings->shuffle_push_order = false;
     machine_settings->shuffle_vm_gpr_order = false;
@@ -291,6 +340,24 @@ int main(int argc, char* argv[])
 
     spdlog::get("console")->info("using random seed {}", util::get_ran_device().seed);
 
+    {
+        const std::shared_ptr<spdlog::logger> file_logger = spdlog::basic_logger_mt<spdlog::async_factory>("test", "x86-tests/partial_exit");
+        const nlohmann::json data = nlohmann::json::parse(partial_exit_tests);
+
+        std::atomic_uint32_t passed = 0;
+        std::atomic_uint32_t failed = 0;
+        for (uint32_t i = 0; i < data.size(); i++)
+            process_entry(machine_settings, data[i], &passed, &failed, i, true);
+
+        spdlog::get("console")->info("partial exit tests passed {} failed {}", passed.load(), failed.load());
+
+        file_logger->flush();
+        spdlog::drop("test");
+
+        total_passed += passed;
+        total_failed += failed;
+    }
+
     // loop each file that test_data_path contains
     for (const auto& entry : std::filesystem::directory_iterator(test_data_path))
     {
@@ -321,7 +388,7 @@ int main(int argc, char* argv[])
         std::for_each(execution_policy, data.begin(), data.end(), [&](auto& n)
         {
             const auto current_task_id = task_id++;
-            process_entry(machine_settings, n, &passed, &failed, current_task_id);
+            process_entry(machine_settings, n, &passed, &failed, current_task_id, false);
         });
 
         spdlog::get("console")->info("finished generating {} tests for: {}", passed + failed, file_name);
@@ -1,10 +1,17 @@
 #include <algorithm>
 #include <filesystem>
+#include <future>
+#include <map>
 #include <ranges>
+#include <string_view>
 
+#include "eaglevm-core/util/random.h"
+#include "eaglevm-core/util/region_arena.h"
+#include "eaglevm-core/util/thread_pool.h"
 #include "eaglevm-core/util/util.h"
 
 #include "eaglevm-core/compiler/section_manager.h"
+#include "eaglevm-core/pe/function_index.h"
 #include "eaglevm-core/pe/packer/pe_packer.h"
 #include "eaglevm-core/pe/pe_generator.h"
 
@@ -23,9 +30,9 @@
 
 using namespace eagle;
 
-void print_graphviz(const std::vector<ir::block_ptr>& blocks, const ir::block_ptr& entry)
+void print_graphviz(std::ostream& out, const std::vector<ir::block_ptr>& blocks, const ir::block_ptr& entry)
 {
-    std::cout << "digraph ControlFlow {\n  graph [splines=ortho]\n  node [shape=box, fontname=\"Courier\"];\n";
+    out << "digraph ControlFlow {\n  graph [splines=ortho]\n  node [shape=box, fontname=\"Courier\"];\n";
 
     for (const auto& block : blocks)
     {
@@ -36,7 +43,7 @@ void print_graphviz(const std::vector<ir::block_ptr>& blocks, const ir::block_pt
         for (const auto& inst : *block)
             insts_nodes << std::format("<TR><TD ALIGN=\"LEFT\">{}</TD></TR>", inst->to_string());
 
-        std::cout << std::format(
+        out << std::format(
             "  \"{}\" [label=<<TABLE BORDER=\"0\">"
             "<TR><TD ALIGN=\"CENTER\"><B>block {}</B></TD></TR>"
             "{}"
@@ -52,7 +59,7 @@ void print_graphviz(const std::vector<ir::block_ptr>& blocks, const ir::block_pt
                 branches = vmexit->get_branches();
 
             for (const auto& call : ptr_virt->get_calls())
-                std::cout << std::format("  \"{}\" -> \"0x{:x}\";\n", node_id, call->block_id);
+                out << std::format("  \"{}\" -> \"0x{:x}\";\n", node_id, call->block_id);
         }
         else if (auto ptr_x86 = block->as_x86())
         {
@@ -68,11 +75,11 @@ void print_graphviz(const std::vector<ir::block_ptr>& blocks, const ir::block_pt
             else
                 target_id = std::format("0x{:x}", std::get<uint64_t>(branch));
 
-            std::cout << std::format("  \"{}\" -> \"{}\";\n", node_id, target_id);
+            out << std::format("  \"{}\" -> \"{}\";\n", node_id, target_id);
         }
     }
 
-    std::cout << "}\n" << std::flush;
+    out << "}\n";
 }
 
 
@@ -86,10 +93,227 @@ void print_ir(const std::vector<ir::block_ptr>& blocks, const ir::block_ptr& ent
     }
 }
 
+struct region_result
+{
+    std::vector<asmb::code_container_ptr> containers;
+    std::vector<std::shared_ptr<virt::base_machine>> machines;
+    asmb::code_label_ptr entry_point;
+
+    // output is buffered per region so that parallel regions do not interleave their logs
+    std::string log;
+};
+
+region_result virtualize_region(const dasm::segment_dasm_ptr& dasm, const util::ran_device& master_device, const ir::settings_ptr& translator_settings,
+    const int c, const uint32_t rva_inst_begin, const uint32_t rva_inst_end)
+{
+    // every region draws from its own stream so the output does not depend on which worker picked it up
+    util::ran_device region_device = master_device.fork(c / 2);
+    util::ran_stream region_stream(region_device);
+
+    // every container and label of the region is bump allocated and released together with the last of them
+    util::arena_scope region_arena(util::region_arena::create());
+
+    region_result region;
+    std::ostringstream log;
+
+    log << std::format("[+] function {}-{}\n", c, c + 1);
+    log << std::format("\t[>] instruction begin: 0x{:x}\n", rva_inst_begin);
+    log << std::format("\t[>] instruction end: 0x{:x}\n", rva_inst_end);
+    log << std::format("\t[>] instruction size: {}\n", rva_inst_end - rva_inst_begin);
+
+    // the segment has already been explored by the function index
+    dasm::analysis::liveness seg_live(dasm);
+    seg_live.compute_blocks_use_def();
+    seg_live.analyze_cross_liveness();
+
+    for (auto& block : dasm->get_blocks())
+    {
+        log << std::format("\nblock 0x{:x}-0x{:x}\n", block->start_rva, block->end_rva_inc);
+
+        auto bitfield_to_bitstring = [](const uint64_t value, const auto sig_bits) -> std::string
+        {
+            std::string result;
+            for (int k = sig_bits - 1; k >= 0; --k)
+                result += value & 1 << k ? '1' : '0';
+
+            return result;
+        };
+
+        const auto& [block_in, block_out] = seg_live.get_live(block);
+
+        log << "in: \n";
+        for (int k = ZYDIS_REGISTER_RAX; k <= ZYDIS_REGISTER_R15; k++)
+            if (auto res = block_in.get_gpr64(static_cast<codec::reg>(k)))
+                log << std::format("\t{}:{}\n", reg_to_string(static_cast<codec::reg>(k)), bitfield_to_bitstring(res, 8));
+
+        log << "out: \n";
+        for (int k = ZYDIS_REGISTER_RAX; k <= ZYDIS_REGISTER_R15; k++)
+            if (auto res = block_out.get_gpr64(static_cast<codec::reg>(k)))
+                log << std::format("\t{}:{}\n", reg_to_string(static_cast<codec::reg>(k)), bitfield_to_bitstring(res, 8));
+
+        auto block_liveness = seg_live.analyze_block(block);
+
+        log << "insts: \n";
+        for (size_t idx = 0; auto& inst : block->decoded_insts)
+        {
+            std::string inst_string = codec::instruction_to_string(inst);
+            log << std::format("\t{}. {}\n", idx, inst_string);
+
+            log << "\tin: \n";
+            for (int k = ZYDIS_REGISTER_RAX; k <= ZYDIS_REGISTER_R15; k++)
+                if (auto res = block_liveness[idx].first.get_gpr64(static_cast<codec::reg>(k)))
+                    log << std::format("\t\t{}:{}\n", reg_to_string(static_cast<codec::reg>(k)), bitfield_to_bitstring(res, 8));
+
+            if (auto res = block_liveness[idx].first.get_flags())
+                log << std::format("\t\trflags:{}\n", bitfield_to_bitstring(res, 32));
+
+            log << "\tout: \n";
+            for (int k = ZYDIS_REGISTER_RAX; k <= ZYDIS_REGISTER_R15; k++)
+                if (auto res = block_liveness[idx].second.get_gpr64(static_cast<codec::reg>(k)))
+                    log << std::format("\t\t{}:{}\n", reg_to_string(static_cast<codec::reg>(k)), bitfield_to_bitstring(res, 8));
+
+            if (auto res = block_liveness[idx].second.get_flags())
+                log << std::format("\t\trflags:{}\n", bitfield_to_bitstring(res, 32));
+
+            idx++;
+        }
+    }
+
+    log << std::format("[>] dasm found {} basic blocks\n\n", dasm->get_blocks().size());
+
+    std::shared_ptr ir_trans = std::make_shared<ir::ir_translator>(dasm, &seg_live, translator_settings);
+    ir::preopt_block_vec preopt = ir_trans->translate();
+
+    // run some basic pre-optimization passes
+    // ir::obfuscator::run_preopt_pass(preopt, &seg_live);
+
+    // here we assign vms to each block
+    // for the current example we can assign the same vm id to each block
+    uint32_t vm_index = 0;
+    std::unordered_map<ir::preopt_block_ptr, uint32_t> block_vm_ids;
+    for (const auto& preopt_block : preopt)
+        block_vm_ids[preopt_block] = vm_index;
+
+    // we want to prevent the vmenter from being removed from the first block,
+    // therefore we mark it as an external call
+    ir::preopt_block_ptr entry_block = nullptr;
+    for (const auto& preopt_block : preopt)
+        if (preopt_block->original_block == dasm->get_block(rva_inst_begin, false))
+            entry_block = preopt_block;
+
+    VM_ASSERT(entry_block != nullptr, "could not find matching preopt block for entry block");
+
+    // if we want, we can do a little optimzation which will rewrite the preopt
+    // blocks, or we could simply ir_trans.flatten()
+    std::unordered_map<ir::preopt_block_ptr, ir::block_ptr> block_tracker = { { entry_block, nullptr } };
+    std::vector<ir::flat_block_vmid> vm_blocks = ir_trans->optimize(block_vm_ids, block_tracker, { entry_block });
+
+    const auto [virtual_edges, removed_exits, removed_enters] = ir_trans->get_transition_stats();
+    if (translator_settings->optimize_same_vm)
+        log << std::format("[>] {} edges stay inside the vm, removed {} vm exits and {} vm enters\n", virtual_edges, removed_exits, removed_enters);
+    else
+        log << "[>] edges between blocks of the same vm stay native\n";
+
+    // ordered by vm id so the containers of a region always come out in the same order
+    std::map<uint32_t, std::vector<ir::block_ptr>> vm_id_map;
+    for (auto& [block, vmid] : vm_blocks)
+    {
+        // while setting up the map we also run the obfuscation pass for handler merging
+        vm_id_map[vmid].append_range(block);
+    }
+
+    for (auto& blocks : vm_id_map | std::views::values)
+    {
+        std::vector<ir::block_ptr> handler_blocks = ir::obfuscator::create_merged_handlers(blocks);
+        blocks.append_range(handler_blocks);
+    }
+
+    // // we want the same settings for every machine
+    // virt::pidg::settings_ptr machine_settings =
+    // std::make_shared<virt::pidg::settings>();
+    // machine_settings->set_temp_count(4);
+    // machine_settings->set_randomize_vm_regs(true);
+    // machine_settings->set_randomize_stack_regs(true);
+
+    virt::eg::settings_ptr machine_settings = std::make_shared<virt::eg::settings>();
+    machine_settings->shuffle_push_order = true;
+    machine_settings->shuffle_vm_gpr_order = true;
+    machine_settings->shuffle_vm_xmm_order = true;
+
+    // initialize block code labels
+    std::unordered_map<ir::block_ptr, asmb::code_label_ptr> block_labels;
+    for (auto& blocks : vm_id_map | std::views::values)
+        for (const auto& block : blocks)
+            block_labels[block] = asmb::code_label::create();
+
+    region.entry_point = asmb::code_label::create();
+    for (const auto& [vm_id, blocks] : vm_id_map)
+    {
+        util::ran_device machine_device = region_device.fork(vm_id);
+        util::ran_stream machine_stream(machine_device);
+
+        // we create a new machine based off of the same settings to make things
+        // more annoying but the same machine could be used :)
+
+        // virt::pidg::machine_ptr machine =
+        // virt::pidg::machine::create(machine_settings);
+        virt::eg::machine_ptr machine = virt::eg::machine::create(machine_settings);
+        region.machines.push_back(machine);
+
+        machine->add_block_context(block_labels);
+
+        const uint32_t stack_reserve = machine->reserve_stack(blocks);
+        log << std::format("[>] vm {} reserves {} bytes of virtual stack\n", vm_id, stack_reserve);
+
+        for (auto i = 0; i < blocks.size(); i++)
+        {
+            auto& translated_block = blocks[i];
+
+            asmb::code_container_ptr result_container = machine->lift_block(translated_block);
+            ir::block_ptr block = block_tracker[entry_block];
+            if (block == translated_block)
+                result_container->bind_start(region.entry_point);
+
+            region.containers.push_back(result_container);
+        }
+
+        print_graphviz(log, blocks, block_tracker[entry_block]);
+
+        // build handlers
+        std::vector<asmb::code_container_ptr> handler_containers = machine->create_handlers();
+
+        const auto [handler_keys, handler_variants, call_bodies, reused_calls, reused_variants, folded_bodies, dead_bodies] =
+            machine->get_handler_stats();
+        log << std::format("[>] vm {} generated {} variants of {} handlers, {} uses picked an existing variant\n",
+            vm_id, handler_variants, handler_keys, reused_variants);
+        log << std::format("[>] vm {} lowered {} handler call bodies, {} calls reused a body\n", vm_id, call_bodies, reused_calls);
+        log << std::format("[>] vm {} folded {} identical handler bodies and dropped {} unreachable ones\n", vm_id, folded_bodies, dead_bodies);
+        region.containers.append_range(handler_containers);
+    }
+
+    region.log = log.str();
+    return region;
+}
+
 int main(int argc, char* argv[])
 {
-    auto executable = argc > 1 ? argv[1] : "EagleVMSandbox.exe";
-    auto parsing_type = argc > 2 ? argv[2] : nullptr;
+    // let two unsupported instructions share one exit and enter when only a short run separates them
+    ir::settings_ptr translator_settings = std::make_shared<ir::settings>();
+    translator_settings->native_run_threshold = 2;
+
+    // --no-same-vm keeps every edge between blocks of the same vm native, to compare the protected binary against one
+    // where control stays inside of the vm
+    std::vector<char*> positional;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string_view(argv[i]) == "--no-same-vm")
+            translator_settings->optimize_same_vm = false;
+        else
+            positional.push_back(argv[i]);
+    }
+
+    auto executable = positional.size() > 0 ? positional[0] : "EagleVMSandbox.exe";
+    auto parsing_type = positional.size() > 1 ? positional[1] : nullptr;
 
     std::ifstream file(executable, std::ios::binary | std::ios::ate);
     if (!file.is_open())
@@ -129,6 +353,10 @@ int main(int argc, char* argv[])
     std::printf("[>] heap reserve -> %I64d bytes\n", nt_header->optional_header.size_heap_reserve);
     std::printf("[>] heap commit -> %I64d bytes\n", nt_header->optional_header.size_heap_commit);
 
+    // function boundaries of the whole image, used to find where marked functions end
+    pe::function_index functions(parser);
+    std::printf("[>] indexed %llu functions\n", functions.get_functions().size());
+
     std::vector<std::pair<pe::stub_import, uint32_t>> vm_iat_calls;
     if (parsing_type)
     {
@@ -170,20 +398,10 @@ int main(int argc, char* argv[])
             }
         }
 
-        const auto exception_data_dir = parser->get_nt_headers()->optional_header.data_directories.exception_directory;
-        const auto exception_data_dir_count = exception_data_dir.size / sizeof(win::runtime_function_t);
-
-        win::runtime_function_t* exception_dir = parser->rva_to_ptr<win::runtime_function_t>(exception_data_dir.rva);
-        for (int i = 0; i < exception_data_dir_count; i++)
+        for (auto& [start, end] : marked_function)
         {
-            auto runtime_func = &exception_dir[i];
-            auto res = std::ranges::find_if(marked_function, [&](auto& a) { return a.first == runtime_func->rva_begin; });
-
-            if (res != marked_function.end())
-            {
-                auto& [start, end] = *res;
-                end = runtime_func->rva_end;
-            }
+            if (const pe::function_range* function = functions.find_entry(start))
+                end = function->rva_end;
         }
 
         for (auto& [start, end] : marked_function)
@@ -295,206 +513,60 @@ int main(int argc, char* argv[])
     std::vector<std::pair<uint32_t, asmb::code_label_ptr>> va_enters;
 
     asmb::section_manager vm_section(true);
+    vm_section.set_branch_relaxation(true);
     std::vector<std::shared_ptr<virt::base_machine>> machines_used;
 
 
     codec::setup_decoder();
+
+    // every marked region runs through its own pipeline on the worker pool
+    // the results are merged back in region order so the section layout does not depend on scheduling
+    util::ran_device& master_device = util::get_ran_device();
+
+    std::vector<pe::function_range> region_ranges;
     for (int c = 0; c < vm_iat_calls.size(); c += 2) // i1 = vm_begin, i2 = vm_end
     {
         // we dont want to account for calls if we are parsing by function names
         const uint8_t call_size_64 = parsing_type ? 0 : 6;
 
-        uint32_t rva_inst_begin = parser->fo_to_rva(vm_iat_calls[c].second) + call_size_64;
-        uint32_t rva_inst_end = parser->fo_to_rva(vm_iat_calls[c + 1].second);
-
-        std::printf("[+] function %i-%i\n", c, c + 1);
-        std::printf("\t[>] instruction begin: 0x%x\n", rva_inst_begin);
-        std::printf("\t[>] instruction end: 0x%x\n", rva_inst_end);
-        std::printf("\t[>] instruction size: %u\n", rva_inst_end - rva_inst_begin);
-
-        uint8_t* pinst_begin = parser->rva_to_ptr<uint8_t>(rva_inst_begin);
-        uint8_t* pinst_end = parser->rva_to_ptr<uint8_t>(rva_inst_end);
-
-        /*
-         * this approach is not a good idea, but its easy to solve
-         * the problem is that this gives us a limited scope of the context
-         * there should be some kind of whole-program context builder because then
-         * we will be able to chain every virtualized code section together.
-         * but this creates sort of a mess which i dont really like
-         */
-
-        dasm::segment_dasm_ptr dasm = std::make_shared<dasm::segment_dasm>(rva_inst_begin, pinst_begin, rva_inst_end - rva_inst_begin);
-        std::vector result = dasm->explore_blocks(rva_inst_begin);
-
-        dasm::analysis::liveness seg_live(dasm);
-        seg_live.compute_blocks_use_def();
-        seg_live.analyze_cross_liveness(result.back());
-
-        for (auto& block : dasm->get_blocks())
-        {
-            printf("\nblock 0x%llx-0x%llx\n", block->start_rva, block->end_rva_inc);
-
-            auto bitfield_to_bitstring = [](const uint64_t value, const auto sig_bits) -> std::string
-            {
-                std::string result;
-                for (int k = sig_bits - 1; k >= 0; --k)
-                    result += value & 1 << k ? '1' : '0';
-
-                return result;
-            };
-
-            printf("in: \n");
-            dasm::analysis::liveness_info& item = seg_live.live[block].first;
-            for (int k = ZYDIS_REGISTER_RAX; k <= ZYDIS_REGISTER_R15; k++)
-                if (auto res = item.get_gpr64(static_cast<codec::reg>(k)))
-                    printf("\t%s:%s\n", reg_to_string(static_cast<codec::reg>(k)), bitfield_to_bitstring(res, 8).c_str());
-
-            printf("out: \n");
-            item = seg_live.live[block].second;
-            for (int k = ZYDIS_REGISTER_RAX; k <= ZYDIS_REGISTER_R15; k++)
-                if (auto res = item.get_gpr64(static_cast<codec::reg>(k)))
-                    printf("\t%s:%s\n", reg_to_string(static_cast<codec::reg>(k)), bitfield_to_bitstring(res, 8).c_str());
-
-            auto block_liveness = seg_live.analyze_block(block);
-
-            printf("insts: \n");
-            for (size_t idx = 0; auto& inst : block->decoded_insts)
-            {
-                std::string inst_string = codec::instruction_to_string(inst);
-                printf("\t%llu. %s\n", idx, inst_string.c_str());
-
-                printf("\tin: \n");
-                for (int k = ZYDIS_REGISTER_RAX; k <= ZYDIS_REGISTER_R15; k++)
-                    if (auto res = block_liveness[idx].first.get_gpr64(static_cast<codec::reg>(k)))
-                        printf("\t\t%s:%s\n", reg_to_string(static_cast<codec::reg>(k)), bitfield_to_bitstring(res, 8).c_str());
-
-                if (auto res = block_liveness[idx].first.get_flags())
-                    printf("\t\trflags:%s\n", bitfield_to_bitstring(res, 32).c_str());
-
-                printf("\tout: \n");
-                for (int k = ZYDIS_REGISTER_RAX; k <= ZYDIS_REGISTER_R15; k++)
-                    if (auto res = block_liveness[idx].second.get_gpr64(static_cast<codec::reg>(k)))
-                        printf("\t\t%s:%s\n", reg_to_string(static_cast<codec::reg>(k)), bitfield_to_bitstring(res, 8).c_str());
-
-                if (auto res = block_liveness[idx].second.get_flags())
-                    printf("\t\trflags:%s\n", bitfield_to_bitstring(res, 32).c_str());
-
-                idx++;
-            }
-        }
-
-        std::printf("[>] dasm found %llu basic blocks\n", dasm->get_blocks().size());
-        std::cout << std::endl;
-
-        std::shared_ptr ir_trans = std::make_shared<ir::ir_translator>(dasm, &seg_live);
-        ir::preopt_block_vec preopt = ir_trans->translate();
-
-        // run some basic pre-optimization passes
-        // ir::obfuscator::run_preopt_pass(preopt, &seg_live);
-
-        // here we assign vms to each block
-        // for the current example we can assign the same vm id to each block
-        uint32_t vm_index = 0;
-        std::unordered_map<ir::preopt_block_ptr, uint32_t> block_vm_ids;
-        for (const auto& preopt_block : preopt)
-            block_vm_ids[preopt_block] = vm_index;
-
-        // we want to prevent the vmenter from being removed from the first block,
-        // therefore we mark it as an external call
-        ir::preopt_block_ptr entry_block = nullptr;
-        for (const auto& preopt_block : preopt)
-            if (preopt_block->original_block == dasm->get_block(rva_inst_begin, false))
-                entry_block = preopt_block;
+        const uint32_t rva_inst_begin = parser->fo_to_rva(vm_iat_calls[c].second) + call_size_64;
+        const uint32_t rva_inst_end = parser->fo_to_rva(vm_iat_calls[c + 1].second);
+        region_ranges.emplace_back(rva_inst_begin, rva_inst_end);
+    }
 
-        VM_ASSERT(entry_block != nullptr, "could not find matching preopt block for entry block");
+    /*
+     * this approach is not a good idea, but its easy to solve
+     * the problem is that this gives us a limited scope of the context
+     * there should be some kind of whole-program context builder because then
+     * we will be able to chain every virtualized code section together.
+     * but this creates sort of a mess which i dont really like
+     */
 
-        // if we want, we can do a little optimzation which will rewrite the preopt
-        // blocks, or we could simply ir_trans.flatten()
-        std::unordered_map<ir::preopt_block_ptr, ir::block_ptr> block_tracker = { { entry_block, nullptr } };
-        std::vector<ir::flat_block_vmid> vm_blocks = ir_trans->optimize(block_vm_ids, block_tracker, { entry_block });
+    // all regions are explored up front, every segment reads from the same image buffer
+    util::thread_pool region_pool;
+    std::vector<dasm::segment_dasm_ptr> region_segments = functions.explore(region_ranges, region_pool);
 
-        std::unordered_map<uint32_t, std::vector<ir::block_ptr>> vm_id_map;
-        for (auto& [block, vmid] : vm_blocks)
-        {
-            // while setting up the map we also run the obfuscation pass for handler merging
-            vm_id_map[vmid].append_range(block);
-        }
-
-        for (auto& blocks : vm_id_map | std::views::values)
-        {
-            std::vector<ir::block_ptr> handler_blocks = ir::obfuscator::create_merged_handlers(blocks);
-            blocks.append_range(handler_blocks);
-
-            // restore calls, for whatever debug reason
-            //for (auto& block : blocks)
-            //{
-            //    if (block->block_id == 0x5f)
-            //        __debugbreak();
-
-            //    for (int i = 0; i < block->size(); i++)
-            //    {
-            //        if (block->at(i)->get_command_type() == ir::command_type::vm_call)
-            //        {
-            //            auto call_s = block->get_command<ir::cmd_call>(i);
-            //            block->erase(block->begin() + i);
-
-            //            auto target = call_s->get_target();
-            //            for (int j = target->size() - 2; j >= 0; j--)
-            //                block->insert(block->begin() + i, target->at(j));
-            //        }
-            //    }
-            //}
-        }
+    std::vector<std::future<region_result>> region_jobs;
+    for (int c = 0; c < vm_iat_calls.size(); c += 2)
+    {
+        const auto [rva_inst_begin, rva_inst_end] = region_ranges[c / 2];
+        const dasm::segment_dasm_ptr& dasm = region_segments[c / 2];
 
-        // // we want the same settings for every machine
-        // virt::pidg::settings_ptr machine_settings =
-        // std::make_shared<virt::pidg::settings>();
-        // machine_settings->set_temp_count(4);
-        // machine_settings->set_randomize_vm_regs(true);
-        // machine_settings->set_randomize_stack_regs(true);
-
-        virt::eg::settings_ptr machine_settings = std::make_shared<virt::eg::settings>();
-        machine_settings->shuffle_push_order = true;
-        machine_settings->shuffle_vm_gpr_order = true;
-        machine_settings->shuffle_vm_xmm_order = true;
-
-        // initialize block code labels
-        std::unordered_map<ir::block_ptr, asmb::code_label_ptr> block_labels;
-        for (auto& blocks : vm_id_map | std::views::values)
-            for (const auto& block : blocks)
-                block_labels[block] = asmb::code_label::create();
-
-        asmb::code_label_ptr entry_point = asmb::code_label::create();
-        for (const auto& blocks : vm_id_map | std::views::values)
+        region_jobs.push_back(region_pool.submit([&dasm, &master_device, &translator_settings, c, rva_inst_begin, rva_inst_end]
         {
-            // we create a new machine based off of the same settings to make things
-            // more annoying but the same machine could be used :)
-
-            // virt::pidg::machine_ptr machine =
-            // virt::pidg::machine::create(machine_settings);
-            virt::eg::machine_ptr machine = virt::eg::machine::create(machine_settings);
-            machines_used.push_back(machine);
-
-            machine->add_block_context(block_labels);
-
-            for (auto i = 0; i < blocks.size(); i++)
-            {
-                auto& translated_block = blocks[i];
-
-                asmb::code_container_ptr result_container = machine->lift_block(translated_block);
-                ir::block_ptr block = block_tracker[entry_block];
-                if (block == translated_block)
-                    result_container->bind_start(entry_point);
+            return virtualize_region(dasm, master_device, translator_settings, c, rva_inst_begin, rva_inst_end);
+        }));
+    }
 
-                vm_section.add_code_container(result_container);
-            }
+    for (int c = 0; c < vm_iat_calls.size(); c += 2)
+    {
+        const uint8_t call_size_64 = parsing_type ? 0 : 6;
 
-            print_graphviz(blocks, block_tracker[entry_block]);
+        region_result result = region_jobs[c / 2].get();
+        std::cout << result.log << std::flush;
 
-            // build handlers
-            std::vector<asmb::code_container_ptr> handler_containers = machine->create_handlers();
-            vm_section.add_code_container(handler_containers);
-        }
+        vm_section.add_code_container(result.containers);
+        machines_used.append_range(result.machines);
 
         // overwrite the original instructions
         uint32_t delete_size = vm_iat_calls[c + 1].second - vm_iat_calls[c].second;
@@ -504,7 +576,7 @@ int main(int argc, char* argv[])
         va_nop.emplace_back(parser->fo_to_rva(vm_iat_calls[c + 1].second), call_size_64);
 
         // add vmenter for root block
-        va_enters.emplace_back(parser->fo_to_rva(vm_iat_calls[c].second), entry_point);
+        va_enters.emplace_back(parser->fo_to_rva(vm_iat_calls[c].second), result.entry_point);
     }
 
     std::printf("\n");
@@ -528,7 +600,13 @@ int main(int argc, char* argv[])
     code_section.num_relocs = 0;
     code_section.num_line_numbers = 0;
 
-    codec::encoded_vec vm_code_bytes = vm_section.compile_section(code_section.virtual_address);
+    codec::encoded_vec vm_code_bytes = vm_section.compile_section(code_section.virtual_address, region_pool);
+    std::printf("[>] %s branch relaxation saved %u bytes\n", code_section.name.to_string().data(), vm_section.get_relaxed_bytes());
+
+    const auto [cache_hits, cache_misses] = vm_section.get_cache_stats();
+    std::printf("[>] %s encoding cache hit %llu of %llu requests (%.1f%%)\n", code_section.name.to_string().data(),
+        cache_hits, cache_hits + cache_misses, cache_hits + cache_misses ? 100.0 * cache_hits / (cache_hits + cache_misses) : 0.0);
+
     code_section.size_raw_data = generator.align_file(vm_code_bytes.size());
     code_section.virtual_size = generator.align_section(vm_code_bytes.size());
     code_section_bytes += vm_code_bytes;
@@ -557,6 +635,7 @@ int main(int argc, char* argv[])
         packer.set_overlay(false);
 
         asmb::section_manager packer_sm = packer.create_section();
+        packer_sm.set_branch_relaxation(true);
 
         auto& [packer_section, packer_bytes] = generator.add_section(".pack");
         packer_section.ptr_raw_data = last_section->ptr_raw_data + last_section->size_raw_data;
@@ -569,6 +648,8 @@ int main(int argc, char* argv[])
         packer_section.num_line_numbers = 0;
 
         codec::encoded_vec packer_code_bytes = packer_sm.compile_section(code_section.virtual_address);
+        std::printf("[>] %s branch relaxation saved %u bytes\n", packer_section.name.to_string().data(), packer_sm.get_relaxed_bytes());
+
         auto [packer_pdb_offset, size] = pe::pe_packer::insert_pdb(packer_code_bytes);
 
         packer_section.size_raw_data = generator.align_file(packer_code_bytes.size());